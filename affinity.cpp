@@ -0,0 +1,335 @@
+#include "affinity.hpp"
+
+#include <algorithm>
+#include <cstdlib>
+#include <fstream>
+#include <set>
+#include <thread>
+
+#ifdef __linux__
+#include <dirent.h>
+#include <pthread.h>
+#include <sched.h>
+#endif
+
+namespace {
+
+// "0-3,8,10-11"
+void parse_cpu_list(const std::string& str, std::vector < int >& cpus)
+{
+  std::string::size_type pos = 0;
+
+  while (pos < str.size()) {
+    std::string::size_type end = str.find(',', pos);
+    std::string item = str.substr(pos, end == std::string::npos ?
+				  std::string::npos : end - pos);
+    std::string::size_type dash = item.find('-');
+
+    if (not item.empty() and item.find_first_of("0123456789") == 0) {
+      int first = std::atoi(item.c_str());
+      int last = dash == std::string::npos ? first :
+	std::atoi(item.c_str() + dash + 1);
+
+      for (int c = first; c <= last; ++c) {
+	cpus.push_back(c);
+      }
+    }
+    if (end == std::string::npos) {
+      break;
+    }
+    pos = end + 1;
+  }
+}
+
+#ifdef __linux__
+
+bool allowed_cpus(std::set < int >& cpus)
+{
+  cpu_set_t set;
+
+  CPU_ZERO(&set);
+  if (sched_getaffinity(0, sizeof(set), &set) != 0) {
+    return false;
+  }
+  for (int c = 0; c < CPU_SETSIZE; ++c) {
+    if (CPU_ISSET(c, &set)) {
+      cpus.insert(c);
+    }
+  }
+  return true;
+}
+
+void read_topology(cpu_topology& topo)
+{
+  const char* root = "/sys/devices/system/node";
+  std::set < int > allowed;
+  std::vector < int > ids;
+  DIR* dir = opendir(root);
+  bool restricted = allowed_cpus(allowed);
+
+  if (dir) {
+    struct dirent* entry;
+
+    while ((entry = readdir(dir)) != 0) {
+      std::string name(entry->d_name);
+
+      if (name.compare(0, 4, "node") == 0 and name.size() > 4 and
+	  name.find_first_not_of("0123456789", 4) == std::string::npos) {
+	ids.push_back(std::atoi(name.c_str() + 4));
+      }
+    }
+    closedir(dir);
+  }
+  std::sort(ids.begin(), ids.end());
+  for (unsigned int i = 0; i < ids.size(); ++i) {
+    std::ifstream file((std::string(root) + "/node" +
+			std::to_string(ids[i]) + "/cpulist").c_str());
+    std::string line;
+    std::vector < int > all;
+    std::vector < int > cpus;
+
+    std::getline(file, line);
+    parse_cpu_list(line, all);
+    for (unsigned int j = 0; j < all.size(); ++j) {
+      if (not restricted or allowed.count(all[j])) {
+	cpus.push_back(all[j]);
+      }
+    }
+    // memory only nodes have no cpu
+    if (not cpus.empty()) {
+      topo.nodes.push_back(cpus);
+    }
+  }
+  if (topo.nodes.empty() and restricted) {
+    topo.nodes.push_back(std::vector < int >(allowed.begin(), allowed.end()));
+  }
+}
+
+#endif
+
+}
+
+namespace {
+
+cpu_topology* load_topology()
+{
+  cpu_topology* topo = new cpu_topology();
+
+#ifdef __linux__
+  read_topology(*topo);
+#endif
+  if (topo->nodes.empty()) {
+    topo->nodes.resize(1);
+    for (unsigned int c = 0;
+	 c < std::max(1u, std::thread::hardware_concurrency()); ++c) {
+      topo->nodes[0].push_back(c);
+    }
+  }
+  for (unsigned int n = 0; n < topo->nodes.size(); ++n) {
+    for (unsigned int i = 0; i < topo->nodes[n].size(); ++i) {
+      topo->node_of_cpu[topo->nodes[n][i]] = n;
+    }
+  }
+  return topo;
+}
+
+}
+
+const cpu_topology& cpu_topology::get()
+{
+  static cpu_topology* topo = load_topology();
+
+  return *topo;
+}
+
+int cpu_topology::node(int cpu) const
+{
+  std::map < int, int >::const_iterator it = node_of_cpu.find(cpu);
+
+  return it == node_of_cpu.end() ? 0 : it->second;
+}
+
+unsigned int cpu_topology::cpu_count() const
+{
+  return node_of_cpu.size();
+}
+
+bool cpu_usable(int cpu)
+{
+#ifdef __linux__
+  std::set < int > allowed;
+
+  if (allowed_cpus(allowed)) {
+    return allowed.count(cpu) > 0;
+  }
+#endif
+  return cpu_topology::get().node_of_cpu.count(cpu) > 0;
+}
+
+placement::placement(policy kind, const std::vector < int >& cpus)
+  : _policy(kind)
+{
+  const cpu_topology& topo = cpu_topology::get();
+
+  switch (kind) {
+  case COMPACT:
+    for (unsigned int n = 0; n < topo.nodes.size(); ++n) {
+      _order.insert(_order.end(), topo.nodes[n].begin(),
+		    topo.nodes[n].end());
+    }
+    break;
+  case SPREAD:
+    for (unsigned int i = 0; _order.size() < topo.cpu_count(); ++i) {
+      for (unsigned int n = 0; n < topo.nodes.size(); ++n) {
+	if (i < topo.nodes[n].size()) {
+	  _order.push_back(topo.nodes[n][i]);
+	}
+      }
+    }
+    break;
+  case LIST:
+    _order = cpus;
+    break;
+  default:
+    break;
+  }
+}
+
+int placement::cpu(unsigned int index) const
+{
+  return empty() ? -1 : _order[index % _order.size()];
+}
+
+void placement::cpus(unsigned int count, std::vector < int >& out) const
+{
+  std::set < int > seen;
+
+  out.clear();
+  for (unsigned int i = 0; not empty() and i < count; ++i) {
+    if (seen.insert(cpu(i)).second) {
+      out.push_back(cpu(i));
+    }
+  }
+}
+
+const char* policy_name(placement::policy kind)
+{
+  switch (kind) {
+  case placement::COMPACT:
+    return "compact";
+  case placement::SPREAD:
+    return "spread";
+  case placement::LIST:
+    return "list";
+  default:
+    return "none";
+  }
+}
+
+bool parse_policy(const std::string& name, placement::policy& kind)
+{
+  if (name == "compact") {
+    kind = placement::COMPACT;
+  } else if (name == "spread") {
+    kind = placement::SPREAD;
+  } else if (name == "none") {
+    kind = placement::NONE;
+  } else {
+    return false;
+  }
+  return true;
+}
+
+#ifdef __linux__
+
+namespace {
+
+bool set_affinity(const std::vector < int >& cpus)
+{
+  cpu_set_t set;
+
+  CPU_ZERO(&set);
+  for (unsigned int i = 0; i < cpus.size(); ++i) {
+    if (cpus[i] >= 0 and cpus[i] < CPU_SETSIZE) {
+      CPU_SET(cpus[i], &set);
+    }
+  }
+  return CPU_COUNT(&set) > 0 and
+    pthread_setaffinity_np(pthread_self(), sizeof(set), &set) == 0;
+}
+
+bool get_affinity(std::vector < int >& cpus)
+{
+  cpu_set_t set;
+
+  CPU_ZERO(&set);
+  if (pthread_getaffinity_np(pthread_self(), sizeof(set), &set) != 0) {
+    return false;
+  }
+  for (int c = 0; c < CPU_SETSIZE; ++c) {
+    if (CPU_ISSET(c, &set)) {
+      cpus.push_back(c);
+    }
+  }
+  return true;
+}
+
+}
+
+bool pin_thread(int cpu)
+{
+  if (cpu >= 0) {
+    return set_affinity(std::vector < int >(1, cpu));
+  }
+
+  const cpu_topology& topo = cpu_topology::get();
+  std::vector < int > all;
+
+  for (unsigned int n = 0; n < topo.nodes.size(); ++n) {
+    all.insert(all.end(), topo.nodes[n].begin(), topo.nodes[n].end());
+  }
+  return set_affinity(all);
+}
+
+int current_node()
+{
+  int cpu = sched_getcpu();
+
+  return cpu < 0 ? 0 : cpu_topology::get().node(cpu);
+}
+
+scoped_affinity::scoped_affinity(const std::vector < int >& cpus)
+  : _active(false)
+{
+  if (not cpus.empty() and get_affinity(_saved)) {
+    _active = set_affinity(cpus);
+  }
+}
+
+scoped_affinity::~scoped_affinity()
+{
+  if (_active) {
+    set_affinity(_saved);
+  }
+}
+
+#else
+
+bool pin_thread(int)
+{
+  return false;
+}
+
+int current_node()
+{
+  return 0;
+}
+
+scoped_affinity::scoped_affinity(const std::vector < int >&)
+  : _active(false)
+{ }
+
+scoped_affinity::~scoped_affinity()
+{ }
+
+#endif
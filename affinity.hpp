@@ -0,0 +1,94 @@
+#ifndef NODE_VLE_AFFINITY_HPP
+#define NODE_VLE_AFFINITY_HPP
+
+#include <map>
+#include <string>
+#include <vector>
+
+/*
+ * Placement of simulation threads on the cores of the machine. The
+ * topology (NUMA nodes and their cpus, restricted to the cpus the
+ * process may use) is read once from sysfs. Without it, or outside
+ * Linux, the machine is a single node and pinning does nothing.
+ *
+ *   compact  fills the cpus of a node before using the next one
+ *   spread   deals the threads to the nodes in turn
+ *   list     the given cpus, in order
+ *
+ * Memory is not bound explicitly: a pinned thread copies the experiment
+ * and builds its results after being pinned, and the first touch policy
+ * of the kernel puts those pages on the node of the thread.
+ */
+
+struct cpu_topology
+{
+  std::vector < std::vector < int > > nodes;    // usable cpus of each node
+  std::map < int, int > node_of_cpu;
+
+  static const cpu_topology& get();
+
+  // 0 when unknown
+  int node(int cpu) const;
+
+  unsigned int cpu_count() const;
+};
+
+// the process may run on cpu (sched_getaffinity)
+bool cpu_usable(int cpu);
+
+class placement
+{
+public:
+  enum policy { NONE, COMPACT, SPREAD, LIST };
+
+  placement() : _policy(NONE)
+  { }
+
+  // cpus is used by LIST only
+  placement(policy kind, const std::vector < int >& cpus);
+
+  bool empty() const
+  { return _policy == NONE or _order.empty(); }
+
+  policy kind() const
+  { return _policy; }
+
+  // cpu of the index-th thread, -1: not pinned
+  int cpu(unsigned int index) const;
+
+  // cpus of the first count threads, without duplicates
+  void cpus(unsigned int count, std::vector < int >& out) const;
+
+private:
+  policy _policy;
+  std::vector < int > _order;
+};
+
+const char* policy_name(placement::policy kind);
+
+bool parse_policy(const std::string& name, placement::policy& kind);
+
+// pins the calling thread on cpu, or releases it on every usable cpu
+// when cpu is -1; false when not supported or refused
+bool pin_thread(int cpu);
+
+// node of the cpu running the calling thread, 0 when unknown
+int current_node();
+
+// restricts the calling thread to some cpus until destroyed; threads it
+// creates meanwhile inherit the restriction
+class scoped_affinity
+{
+public:
+  explicit scoped_affinity(const std::vector < int >& cpus);
+  ~scoped_affinity();
+
+private:
+  scoped_affinity(const scoped_affinity&);
+  scoped_affinity& operator=(const scoped_affinity&);
+
+  std::vector < int > _saved;
+  bool _active;
+};
+
+#endif
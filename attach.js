@@ -0,0 +1,28 @@
+// Typed views on a result delivered with {shared: true}: one Float64Array
+// per column on the SharedArrayBuffer, laid out as a typed result. Does
+// not need the addon, so that worker threads can require it alone.
+
+function attach(shared) {
+  var columns = shared.schema.columns;
+  var result = {};
+  var nulls = {};
+
+  for (var i = 0; i < columns.length; ++i) {
+    var c = columns[i];
+    var node = result[c.view] || (result[c.view] = {});
+
+    for (var j = 0; j < c.path.length - 1; ++j) {
+      node = node[c.path[j]] || (node[c.path[j]] = {});
+    }
+    node[c.path[c.path.length - 1]] = new Float64Array(shared.buffer,
+                                                       c.offset, c.rows);
+    if (c.nulls !== null) {
+      nulls[c.name] = new Uint8Array(shared.buffer, c.nulls,
+                                     (c.rows + 7) >> 3);
+    }
+  }
+  Object.defineProperty(result, 'nulls', { value: nulls });
+  return result;
+}
+
+module.exports = attach;
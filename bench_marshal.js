@@ -0,0 +1,20 @@
+// Result marshalling through the addon's own convert, with the key and
+// view template cache emptied before each round (cold) or kept (warm).
+// The benchmark is not built by npm install:
+//   node-gyp rebuild -- -Dbuild_bench=true
+//   node bench_marshal.js [columns] [rows] [rounds]
+
+var bench = require('./build/Release/vle_node_bench');
+var columns = parseInt(process.argv[2] || '256', 10);
+var rows = parseInt(process.argv[3] || '16', 10);
+var rounds = parseInt(process.argv[4] || '200', 10);
+
+// warm up before measuring
+bench.bench_convert(columns, rows, Math.max(1, rounds / 10));
+
+var res = bench.bench_convert(columns, rows, rounds);
+
+console.log('columns: ' + columns + ', rows: ' + rows + ', rounds: ' + rounds);
+console.log('cold:    ' + res.cold.toFixed(3) + ' ms/result');
+console.log('warm:    ' + res.warm.toFixed(3) + ' ms/result');
+console.log('speedup: ' + (res.cold / res.warm).toFixed(2));
@@ -1,13 +1,32 @@
 {
+  "variables": {
+    # node-gyp rebuild -- -Dbuild_bench=true adds vle_node_bench
+    "build_bench%": "false"
+  },
+  "target_defaults": {
+    "sources": [ "wrapper.cpp", "optimizer.cpp", "result.cpp", "colfile.cpp",
+                 "snapshot.cpp", "scheduler.cpp", "compress.cpp",
+                 "compare.cpp", "affinity.cpp", "trace.cpp",
+                 "memory.cpp" ],
+    "include_dirs": [ "<!@(pkg-config --cflags-only-I vle-1.1 | sed s/-I//g)" ],
+    "libraries": [ "<!@(pkg-config --libs vle-1.1)" ],
+    "cflags!": [ '-fno-exceptions' ],
+    "cflags": [ "-std=c++11" ],
+    "cflags_cc!": [ "-fno-exceptions", "-fno-rtti" ]
+  },
   "targets": [
     {
-      "target_name": "vle_node",
-      "sources": [ "wrapper.cpp" ],
-      "include_dirs": [ "<!@(pkg-config --cflags-only-I vle-1.1 | sed s/-I//g)" ],
-      "libraries": [ "<!@(pkg-config --libs vle-1.1)" ],
-      "cflags!": [ '-fno-exceptions' ],
-      "cflags": [ "-std=c++11" ],
-      "cflags_cc!": [ "-fno-exceptions", "-fno-rtti" ]
+      "target_name": "vle_node"
     }
+  ],
+  "conditions": [
+    [ "build_bench=='true'", {
+      "targets": [
+        {
+          "target_name": "vle_node_bench",
+          "defines": [ "NODE_VLE_BENCH" ]
+        }
+      ]
+    } ]
   ]
-}
\ No newline at end of file
+}
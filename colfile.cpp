@@ -0,0 +1,574 @@
+#include "colfile.hpp"
+
+#include <algorithm>
+#include <cmath>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <fstream>
+#include <limits>
+#include <stdexcept>
+
+#include <dirent.h>
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+namespace {
+
+const char magic[8] = { 'V', 'L', 'E', 'C', 'O', 'L', 'S', '\0' };
+const uint32_t version = 1;
+
+uint64_t align8(uint64_t x)
+{
+  return (x + 7) & ~static_cast < uint64_t >(7);
+}
+
+uint64_t entry_size(const std::string& name)
+{
+  return align8(sizeof(uint32_t) + name.size()) + 3 * sizeof(uint64_t);
+}
+
+template < typename T >
+void put(uint8_t*& p, T value)
+{
+  std::memcpy(p, &value, sizeof(T));
+  p += sizeof(T);
+}
+
+template < typename T >
+T get(const uint8_t*& p, const uint8_t* end)
+{
+  T value;
+
+  if (p + sizeof(T) > end) {
+    throw std::runtime_error("column file: truncated directory");
+  }
+  std::memcpy(&value, p, sizeof(T));
+  p += sizeof(T);
+  return value;
+}
+
+}
+
+namespace {
+
+struct csv_view
+{
+  std::string view;
+  std::string file;
+  char separator;
+  std::vector < std::string > names;
+  unsigned int time;                    // index of the time column
+  std::vector < bool > nullable;
+  uint64_t lines;
+  bool all;                             // every line kept, no samples
+  std::vector < row_sample > samples;
+  std::vector < uint64_t > data;        // offsets of the columns
+  std::vector < uint64_t > nulls;
+
+  uint64_t rows() const
+  { return all ? lines : samples.size(); }
+};
+
+std::string unquote(const std::string& cell)
+{
+  size_t begin = cell.find_first_not_of(" \r\"");
+  size_t end = cell.find_last_not_of(" \r\"");
+
+  return begin == std::string::npos ? std::string() :
+    cell.substr(begin, end - begin + 1);
+}
+
+// false for empty cells, NA and non numeric observations
+bool parse_cell(const std::string& cell, double& value)
+{
+  std::string text = unquote(cell);
+  char* end;
+
+  if (text == "true" or text == "false") {
+    value = text == "true" ? 1.0 : 0.0;
+    return true;
+  }
+  value = std::strtod(text.c_str(), &end);
+  if (text.empty() or *end != '\0') {
+    value = std::numeric_limits < double >::quiet_NaN();
+    return false;
+  }
+  return true;
+}
+
+// column name of a file plugin header, coupled:atomic.port like the
+// storage plugin
+std::string csv_column_name(const std::string& view, const std::string& header)
+{
+  if (header != "time" and (header.find(':') == std::string::npos or
+			    header.find('.') == std::string::npos)) {
+    return view + "." + header;
+  }
+  return column_name(view, header);
+}
+
+// the plugin names its file after the experiment and the view
+std::string find_csv(const csv_output& output)
+{
+  std::vector < std::string > found;
+  std::string suffix = "_" + output.view + ".csv";
+  DIR* dir = ::opendir(output.directory.c_str());
+
+  if (not dir) {
+    throw std::runtime_error("column file: no output for " + output.view);
+  }
+  while (struct dirent* e = ::readdir(dir)) {
+    std::string name = e->d_name;
+
+    if (name.size() > 4 and name.compare(name.size() - 4, 4, ".csv") == 0) {
+      if (name.size() >= suffix.size() and
+	  name.compare(name.size() - suffix.size(), suffix.size(),
+		       suffix) == 0) {
+	found.insert(found.begin(), name);
+      } else {
+	found.push_back(name);
+      }
+    }
+  }
+  ::closedir(dir);
+  if (found.empty()) {
+    throw std::runtime_error("column file: no output for " + output.view);
+  }
+  return output.directory + "/" + found.front();
+}
+
+void read_layout(csv_view& v, const view_filter* filter)
+{
+  std::ifstream in(v.file.c_str());
+  std::string line;
+  std::vector < std::string > cells;
+  std::vector < double > times;
+
+  if (not std::getline(in, line)) {
+    throw std::runtime_error("column file: empty output " + v.file);
+  }
+  v.separator = line.find(';') != std::string::npos ? ';' :
+    line.find('\t') != std::string::npos ? '\t' : ',';
+  split(line, v.separator, cells);
+  v.time = cells.size();
+  for (unsigned int c = 0; c < cells.size(); ++c) {
+    std::string header = unquote(cells[c]);
+
+    if (header == "time") {
+      v.time = c;
+    }
+    v.names.push_back(csv_column_name(v.view, header));
+  }
+  v.nullable.assign(v.names.size(), false);
+  // an active filter keeps no row of a view without time
+  v.all = not filter or not filter->active();
+
+  v.lines = 0;
+  while (std::getline(in, line)) {
+    if (line.empty() or line == "\r") {
+      continue;
+    }
+    cells.clear();
+    split(line, v.separator, cells);
+    for (unsigned int c = 0; c < v.names.size(); ++c) {
+      double value;
+      bool number = c < cells.size() and parse_cell(cells[c], value);
+
+      if (not number) {
+	v.nullable[c] = true;
+      }
+      if (c == v.time and not v.all) {
+	times.push_back(number ? value :
+			std::numeric_limits < double >::quiet_NaN());
+      }
+    }
+    ++v.lines;
+  }
+  if (not v.all and v.time < v.names.size()) {
+    select_times(times, *filter, v.samples);
+    if (filter->grid > 0) {
+      v.nullable[v.time] = false;
+    }
+  }
+}
+
+void read_values(const std::string& line, char separator,
+		 std::vector < std::string >& cells,
+		 std::vector < double >& values, std::vector < bool >& nulls)
+{
+  cells.clear();
+  split(line, separator, cells);
+  for (unsigned int c = 0; c < values.size(); ++c) {
+    nulls[c] = not (c < cells.size() and parse_cell(cells[c], values[c]));
+    if (nulls[c]) {
+      values[c] = std::numeric_limits < double >::quiet_NaN();
+    }
+  }
+}
+
+void fill_view(uint8_t* base, const csv_view& v)
+{
+  std::ifstream in(v.file.c_str());
+  std::string line;
+  std::vector < std::string > cells;
+  unsigned int width = v.names.size();
+  std::vector < double > current(width), held(width);
+  std::vector < bool > current_nulls(width), held_nulls(width);
+  uint64_t r = 0;
+  size_t j = 0;
+
+  std::getline(in, line);
+  while (std::getline(in, line) and r < v.lines) {
+    if (line.empty() or line == "\r") {
+      continue;
+    }
+    read_values(line, v.separator, cells, current, current_nulls);
+
+    // a sample is written once the line of its next value is read; the
+    // line of its own value is either this one or the held one
+    while (v.all ? j == r :
+	   (j < v.samples.size() and v.samples[j].next == r)) {
+      const row_sample* s = v.all ? 0 : &v.samples[j];
+      bool own = not s or s->row == r;
+
+      for (unsigned int c = 0; c < width; ++c) {
+	double* data = reinterpret_cast < double* >(base + v.data[c]);
+	double value = own ? current[c] : held[c];
+	bool null = own ? current_nulls[c] : held_nulls[c];
+
+	if (s and s->resampled and c == v.time) {
+	  value = s->time;
+	  null = false;
+	} else if (s and s->weight > 0 and not std::isnan(value) and
+		   not std::isnan(current[c])) {
+	  value = (1 - s->weight) * value + s->weight * current[c];
+	}
+	data[j] = value;
+	if (null and v.nulls[c]) {
+	  base[v.nulls[c] + j / 8] |= 1 << (j % 8);
+	}
+      }
+      ++j;
+    }
+    if (not v.all and j < v.samples.size() and v.samples[j].row == r) {
+      held = current;
+      held_nulls = current_nulls;
+    }
+    ++r;
+  }
+}
+
+}
+
+void write_column_file(const std::string& path,
+		       const std::vector < csv_output >& outputs,
+		       const view_filters* filters)
+{
+  std::vector < csv_view > views(outputs.size());
+  uint64_t size = 24;
+  uint64_t count = 0;
+
+  // first pass: names, rows kept by the filters and nullable columns
+  for (unsigned int i = 0; i < outputs.size(); ++i) {
+    const view_filter* filter = 0;
+
+    if (filters) {
+      view_filters::const_iterator f = filters->find(outputs[i].view);
+
+      if (f != filters->end()) {
+	filter = &f->second;
+      }
+    }
+    views[i].view = outputs[i].view;
+    views[i].file = find_csv(outputs[i]);
+    read_layout(views[i], filter);
+    for (unsigned int c = 0; c < views[i].names.size(); ++c) {
+      size += entry_size(views[i].names[c]);
+      ++count;
+    }
+  }
+  for (unsigned int i = 0; i < views.size(); ++i) {
+    csv_view& v = views[i];
+
+    for (unsigned int c = 0; c < v.names.size(); ++c) {
+      v.data.push_back(size);
+      size += v.rows() * sizeof(double);
+      v.nulls.push_back(v.nullable[c] ? size : 0);
+      if (v.nullable[c]) {
+	size += align8((v.rows() + 7) / 8);
+      }
+    }
+  }
+
+  // written under a temporary name so that a reader never maps a
+  // partial file; mkstemp gives every writer its own name
+  std::string tmp = path + ".XXXXXX";
+  int fd = ::mkstemp(&tmp[0]);
+
+  if (fd < 0) {
+    throw std::runtime_error("column file: cannot create " + path);
+  }
+  if (::fchmod(fd, 0644) != 0 or ::ftruncate(fd, size) != 0) {
+    ::close(fd);
+    ::unlink(tmp.c_str());
+    throw std::runtime_error("column file: cannot resize " + tmp);
+  }
+
+  void* addr = ::mmap(0, size, PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+
+  ::close(fd);
+  if (addr == MAP_FAILED) {
+    ::unlink(tmp.c_str());
+    throw std::runtime_error("column file: cannot map " + tmp);
+  }
+
+  uint8_t* base = static_cast < uint8_t* >(addr);
+  uint8_t* dir = base;
+
+  std::memcpy(dir, magic, sizeof(magic));
+  dir += sizeof(magic);
+  put < uint32_t >(dir, version);
+  put < uint32_t >(dir, count);
+  put < uint64_t >(dir, size);
+
+  // second pass: directory and data
+  try {
+    for (unsigned int i = 0; i < views.size(); ++i) {
+      const csv_view& v = views[i];
+
+      for (unsigned int c = 0; c < v.names.size(); ++c) {
+	uint8_t* entry = dir;
+
+	put < uint32_t >(dir, v.names[c].size());
+	std::memcpy(dir, v.names[c].data(), v.names[c].size());
+	dir = entry + align8(sizeof(uint32_t) + v.names[c].size());
+	put < uint64_t >(dir, v.rows());
+	put < uint64_t >(dir, v.data[c]);
+	put < uint64_t >(dir, v.nulls[c]);
+      }
+      fill_view(base, v);
+    }
+  } catch (...) {
+    ::munmap(addr, size);
+    ::unlink(tmp.c_str());
+    throw;
+  }
+
+  ::msync(addr, size, MS_SYNC);
+  ::munmap(addr, size);
+  if (std::rename(tmp.c_str(), path.c_str()) != 0) {
+    ::unlink(tmp.c_str());
+    throw std::runtime_error("column file: cannot rename " + tmp);
+  }
+}
+
+bool read_last_row(const csv_output& output,
+		   std::vector < std::string >& names,
+		   std::vector < double >& values)
+{
+  std::string file;
+
+  try {
+    file = find_csv(output);
+  } catch (const std::runtime_error&) {
+    // not created yet
+    return false;
+  }
+
+  std::ifstream in(file.c_str(), std::ios::binary);
+  std::string header;
+
+  if (not std::getline(in, header) or in.eof()) {
+    return false;
+  }
+
+  std::streamoff first = in.tellg();
+  std::streamoff from;
+  std::string tail;
+  size_t last = std::string::npos;
+  size_t before = std::string::npos;
+
+  in.seekg(0, std::ios::end);
+  from = in.tellg();
+
+  // back from the end, block by block, until the tail holds the newline
+  // closing the last row and the one before it
+  while (from > first) {
+    std::streamoff size = std::min < std::streamoff >(4096, from - first);
+    std::string block(size, '\0');
+
+    from -= size;
+    in.seekg(from);
+    if (not in.read(&block[0], size)) {
+      return false;
+    }
+    tail = block + tail;
+    last = tail.rfind('\n');
+    if (last != std::string::npos and last > 0 and
+	(before = tail.rfind('\n', last - 1)) != std::string::npos) {
+      break;
+    }
+  }
+  if (last == std::string::npos) {
+    return false;
+  }
+
+  std::string line = tail.substr(before == std::string::npos ? 0 :
+				 before + 1,
+				 before == std::string::npos ? last :
+				 last - before - 1);
+  char separator = header.find(';') != std::string::npos ? ';' :
+    header.find('\t') != std::string::npos ? '\t' : ',';
+  std::vector < std::string > cells;
+
+  if (line.empty() or line == "\r") {
+    return false;
+  }
+  names.clear();
+  split(header, separator, cells);
+  for (unsigned int c = 0; c < cells.size(); ++c) {
+    names.push_back(csv_column_name(output.view, unquote(cells[c])));
+  }
+  values.assign(names.size(), 0.0);
+  cells.clear();
+  split(line, separator, cells);
+  for (unsigned int c = 0; c < values.size(); ++c) {
+    if (not (c < cells.size() and parse_cell(cells[c], values[c]))) {
+      values[c] = std::numeric_limits < double >::quiet_NaN();
+    }
+  }
+  return true;
+}
+
+scratch_directory::scratch_directory(const std::string& near)
+  : _path(near + ".XXXXXX")
+{
+  if (not ::mkdtemp(&_path[0])) {
+    throw std::runtime_error("column file: cannot create a directory next "
+			     "to " + near);
+  }
+}
+
+scratch_directory::~scratch_directory()
+{
+  // two levels: the subdirectories and the files of the plugins
+  DIR* top = ::opendir(_path.c_str());
+
+  while (struct dirent* e = top ? ::readdir(top) : 0) {
+    std::string name = e->d_name;
+
+    if (name == "." or name == "..") {
+      continue;
+    }
+
+    std::string sub = _path + "/" + name;
+    DIR* dir = ::opendir(sub.c_str());
+
+    while (struct dirent* f = dir ? ::readdir(dir) : 0) {
+      if (std::strcmp(f->d_name, ".") != 0 and
+	  std::strcmp(f->d_name, "..") != 0) {
+	::unlink((sub + "/" + f->d_name).c_str());
+      }
+    }
+    if (dir) {
+      ::closedir(dir);
+    }
+    ::rmdir(sub.c_str());
+  }
+  if (top) {
+    ::closedir(top);
+  }
+  ::rmdir(_path.c_str());
+}
+
+std::string scratch_directory::make(const std::string& name) const
+{
+  std::string sub = _path + "/" + name;
+
+  if (::mkdir(sub.c_str(), 0755) != 0) {
+    throw std::runtime_error("column file: cannot create " + sub);
+  }
+  return sub;
+}
+
+column_file::column_file(const std::string& path)
+  : _path(path), _base(0), _size(0)
+{
+  int fd = ::open(path.c_str(), O_RDONLY);
+  struct stat st;
+
+  if (fd < 0) {
+    throw std::runtime_error("column file: cannot open " + path);
+  }
+  if (::fstat(fd, &st) != 0 or st.st_size < 24) {
+    ::close(fd);
+    throw std::runtime_error("column file: bad file " + path);
+  }
+  _size = st.st_size;
+
+  // private mapping: typed arrays built on it may be written by
+  // javascript without touching the file
+  void* addr = ::mmap(0, _size, PROT_READ | PROT_WRITE, MAP_PRIVATE, fd, 0);
+
+  ::close(fd);
+  if (addr == MAP_FAILED) {
+    throw std::runtime_error("column file: cannot map " + path);
+  }
+  _base = static_cast < uint8_t* >(addr);
+
+  try {
+    const uint8_t* p = _base + sizeof(magic);
+    const uint8_t* end = _base + _size;
+
+    if (std::memcmp(_base, magic, sizeof(magic)) != 0 or
+	get < uint32_t >(p, end) != version) {
+      throw std::runtime_error("column file: bad header in " + path);
+    }
+
+    uint32_t count = get < uint32_t >(p, end);
+
+    if (get < uint64_t >(p, end) != _size) {
+      throw std::runtime_error("column file: truncated " + path);
+    }
+    for (uint32_t i = 0; i < count; ++i) {
+      const uint8_t* start = p;
+      uint32_t length = get < uint32_t >(p, end);
+      entry e;
+
+      if (p + length > end) {
+	throw std::runtime_error("column file: truncated directory");
+      }
+      e.name.assign(reinterpret_cast < const char* >(p), length);
+      p = start + align8(sizeof(uint32_t) + length);
+      e.rows = get < uint64_t >(p, end);
+      e.data = get < uint64_t >(p, end);
+      e.nulls = get < uint64_t >(p, end);
+      if (e.data % 8 != 0 or e.data + e.rows * sizeof(double) > _size or
+	  (e.nulls and e.nulls + (e.rows + 7) / 8 > _size)) {
+	throw std::runtime_error("column file: bad column " + e.name);
+      }
+      _columns.push_back(e);
+    }
+  } catch (...) {
+    ::munmap(_base, _size);
+    throw;
+  }
+}
+
+column_file::~column_file()
+{
+  ::munmap(_base, _size);
+}
+
+int column_file::find(const std::string& name) const
+{
+  for (unsigned int i = 0; i < _columns.size(); ++i) {
+    if (_columns[i].name == name) {
+      return i;
+    }
+  }
+  return -1;
+}
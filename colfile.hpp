@@ -0,0 +1,114 @@
+#ifndef NODE_VLE_COLFILE_HPP
+#define NODE_VLE_COLFILE_HPP
+
+#include "result.hpp"
+
+#include <stdint.h>
+#include <string>
+#include <vector>
+
+/*
+ * Self describing columnar result file, written and read through
+ * mmap. All integers are native endian.
+ *
+ *   char     magic[8]          "VLECOLS"
+ *   uint32   version
+ *   uint32   column count
+ *   uint64   file size
+ *   column directory, one entry per column:
+ *     uint32 name length, name (view.coupled.atomic.port), padding to 8
+ *     uint64 rows
+ *     uint64 offset of the rows doubles
+ *     uint64 offset of the null bitmap (bit i set: row i is null), 0: none
+ *   data, every block aligned on 8 bytes
+ *
+ * Null or non numeric observations are stored as NaN.
+ */
+
+// csv file written during the run by the vle.output "file" plugin of
+// a view, in its own directory
+struct csv_output
+{
+  std::string view;
+  std::string directory;
+};
+
+// converts the csv files of the views into one column file, applying
+// the view filters. The files are read twice, line by line: once for
+// the layout, once to fill the mapping, so the memory used does not
+// depend on the number of observations.
+void write_column_file(const std::string& path,
+		       const std::vector < csv_output >& outputs,
+		       const view_filters* filters);
+
+// last complete row the file plugin of a view has written so far, by
+// column name, NaN for non numeric cells; false while there is none.
+// Only the header and the end of the file are read.
+bool read_last_row(const csv_output& output,
+		   std::vector < std::string >& names,
+		   std::vector < double >& values);
+
+// directory created next to a path for the csv files of a run, removed
+// with its content
+class scratch_directory
+{
+public:
+  explicit scratch_directory(const std::string& near);
+  ~scratch_directory();
+
+  const std::string& path() const
+  { return _path; }
+
+  // new subdirectory
+  std::string make(const std::string& name) const;
+
+private:
+  scratch_directory(const scratch_directory&);
+  scratch_directory& operator=(const scratch_directory&);
+
+  std::string _path;
+};
+
+class column_file
+{
+public:
+  struct entry
+  {
+    std::string name;
+    uint64_t rows;
+    uint64_t data;
+    uint64_t nulls;
+  };
+
+  explicit column_file(const std::string& path);
+  ~column_file();
+
+  const std::string& path() const
+  { return _path; }
+
+  const std::vector < entry >& columns() const
+  { return _columns; }
+
+  // index of the column or -1
+  int find(const std::string& name) const;
+
+  double* data(const entry& e) const
+  { return reinterpret_cast < double* >(_base + e.data); }
+
+  uint8_t* nulls(const entry& e) const
+  { return e.nulls ? _base + e.nulls : 0; }
+
+  uint64_t size() const
+  { return _size; }
+
+private:
+  column_file(const column_file&);
+  column_file& operator=(const column_file&);
+
+  std::string _path;
+  std::vector < entry > _columns;
+  uint8_t* _base;
+  uint64_t _size;
+};
+
+#endif
@@ -0,0 +1,54 @@
+#include "compare.hpp"
+
+#include <algorithm>
+#include <cmath>
+
+void compare_columns(const double* a, size_t na, const double* b, size_t nb,
+		     double atol, double rtol, column_diff& diff)
+{
+  size_t n = std::min(na, nb);
+  double max_error = 0;
+  double sum = 0;
+  size_t numbers = 0;
+  size_t failures = 0;
+
+  // branch free so that the compiler vectorizes the whole column, the
+  // first divergence is only searched when there is one
+  for (size_t i = 0; i < n; ++i) {
+    double x = a[i];
+    double y = b[i];
+    bool nx = std::isnan(x);
+    bool ny = std::isnan(y);
+    double e = nx or ny ? 0.0 : std::fabs(x - y);
+    bool close = (nx and ny) or
+      (not nx and not ny and e <= atol + rtol * std::fabs(y));
+
+    max_error = std::max(max_error, e);
+    sum += e * e;
+    numbers += not nx and not ny;
+    failures += not close;
+  }
+
+  diff.rows = n;
+  diff.failures = failures;
+  diff.max_error = max_error;
+  diff.rms_error = numbers ? std::sqrt(sum / numbers) : 0.0;
+  diff.first_divergence = -1;
+  if (failures) {
+    for (size_t i = 0; i < n; ++i) {
+      double x = a[i];
+      double y = b[i];
+      bool nx = std::isnan(x);
+      bool ny = std::isnan(y);
+
+      if (nx != ny or
+	  (not nx and std::fabs(x - y) > atol + rtol * std::fabs(y))) {
+	diff.first_divergence = i;
+	break;
+      }
+    }
+  } else if (na != nb) {
+    diff.first_divergence = n;
+  }
+  diff.passed = failures == 0 and na == nb;
+}
@@ -0,0 +1,32 @@
+#ifndef NODE_VLE_COMPARE_HPP
+#define NODE_VLE_COMPARE_HPP
+
+#include <stddef.h>
+#include <string>
+
+/*
+ * Comparison of two observed series within tolerances: rows match when
+ * |a - b| <= atol + rtol * |b| (b is the reference), or when both are
+ * NaN. A NaN on one side only is a divergence and is left out of the
+ * error statistics.
+ */
+
+struct column_diff
+{
+  column_diff()
+    : rows(0), failures(0), max_error(0), rms_error(0), first_divergence(-1),
+      passed(true)
+  { }
+
+  size_t rows;                  // rows compared
+  size_t failures;
+  double max_error;             // on the rows where both sides are numbers
+  double rms_error;
+  long first_divergence;        // row index, -1: none
+  bool passed;                  // no failure and the same number of rows
+};
+
+void compare_columns(const double* a, size_t na, const double* b, size_t nb,
+		     double atol, double rtol, column_diff& diff);
+
+#endif
@@ -0,0 +1,372 @@
+#include "compress.hpp"
+
+#include <algorithm>
+#include <cstring>
+#include <stdexcept>
+
+namespace {
+
+inline uint64_t bits_of(double x)
+{
+  uint64_t b;
+
+  std::memcpy(&b, &x, sizeof(b));
+  return b;
+}
+
+inline double double_of(uint64_t b)
+{
+  double x;
+
+  std::memcpy(&x, &b, sizeof(x));
+  return x;
+}
+
+inline unsigned int leading_zeros(uint64_t x)
+{
+  return x ? __builtin_clzll(x) : 64;
+}
+
+inline unsigned int trailing_zeros(uint64_t x)
+{
+  return x ? __builtin_ctzll(x) : 64;
+}
+
+class bit_writer
+{
+public:
+  explicit bit_writer(std::vector < uint8_t >& out) : _out(out), _used(8)
+  { }
+
+  void write(uint64_t value, unsigned int count)
+  {
+    while (count > 0) {
+      if (_used == 8) {
+	_out.push_back(0);
+	_used = 0;
+      }
+
+      unsigned int n = std::min(count, 8 - _used);
+      uint8_t chunk = (value >> (count - n)) & ((1u << n) - 1);
+
+      _out.back() |= chunk << (8 - _used - n);
+      _used += n;
+      count -= n;
+    }
+  }
+
+private:
+  std::vector < uint8_t >& _out;
+  unsigned int _used;
+};
+
+class bit_reader
+{
+public:
+  explicit bit_reader(const std::vector < uint8_t >& in)
+    : _in(in), _pos(0)
+  { }
+
+  uint64_t read(unsigned int count)
+  {
+    uint64_t value = 0;
+
+    while (count > 0) {
+      if (_pos / 8 >= _in.size()) {
+	throw std::runtime_error("compressed column: truncated stream");
+      }
+
+      unsigned int used = _pos % 8;
+      unsigned int n = std::min(count, 8 - used);
+      uint8_t chunk = (_in[_pos / 8] >> (8 - used - n)) & ((1u << n) - 1);
+
+      value = (value << n) | chunk;
+      _pos += n;
+      count -= n;
+    }
+    return value;
+  }
+
+private:
+  const std::vector < uint8_t >& _in;
+  size_t _pos;
+};
+
+void put_u64(std::vector < uint8_t >& out, uint64_t x)
+{
+  for (unsigned int i = 0; i < 8; ++i) {
+    out.push_back(x >> (8 * i));
+  }
+}
+
+uint64_t get_u64(const std::vector < uint8_t >& in, size_t& pos)
+{
+  uint64_t x = 0;
+
+  if (pos + 8 > in.size()) {
+    throw std::runtime_error("compressed column: truncated stream");
+  }
+  for (unsigned int i = 0; i < 8; ++i) {
+    x |= static_cast < uint64_t >(in[pos++]) << (8 * i);
+  }
+  return x;
+}
+
+void put_varint(std::vector < uint8_t >& out, uint64_t x)
+{
+  while (x >= 0x80) {
+    out.push_back((x & 0x7f) | 0x80);
+    x >>= 7;
+  }
+  out.push_back(x);
+}
+
+uint64_t get_varint(const std::vector < uint8_t >& in, size_t& pos)
+{
+  uint64_t x = 0;
+
+  for (unsigned int shift = 0; shift < 64; shift += 7) {
+    if (pos >= in.size()) {
+      throw std::runtime_error("compressed column: truncated stream");
+    }
+
+    uint8_t b = in[pos++];
+
+    x |= static_cast < uint64_t >(b & 0x7f) << shift;
+    if (not (b & 0x80)) {
+      break;
+    }
+  }
+  return x;
+}
+
+bool encode_linear(const double* data, size_t rows,
+		   std::vector < uint8_t >& out)
+{
+  if (rows < 2) {
+    return false;
+  }
+
+  double first = data[0];
+  double step = data[1] - data[0];
+
+  for (size_t i = 0; i < rows; ++i) {
+    if (bits_of(first + i * step) != bits_of(data[i])) {
+      return false;
+    }
+  }
+  put_u64(out, bits_of(first));
+  put_u64(out, bits_of(step));
+  return true;
+}
+
+// gives up as soon as the runs are not smaller than limit
+bool encode_rle(const double* data, size_t rows, size_t limit,
+		std::vector < uint8_t >& out)
+{
+  size_t i = 0;
+
+  while (i < rows) {
+    uint64_t b = bits_of(data[i]);
+    size_t j = i + 1;
+
+    while (j < rows and bits_of(data[j]) == b) {
+      ++j;
+    }
+    put_u64(out, b);
+    put_varint(out, j - i);
+    if (out.size() >= limit) {
+      return false;
+    }
+    i = j;
+  }
+  return true;
+}
+
+void encode_xor(const double* data, size_t rows, std::vector < uint8_t >& out)
+{
+  bit_writer w(out);
+  uint64_t prev = bits_of(data[0]);
+  unsigned int lead = 65;       // no window yet
+  unsigned int trail = 0;
+
+  w.write(prev, 64);
+  for (size_t i = 1; i < rows; ++i) {
+    uint64_t cur = bits_of(data[i]);
+    uint64_t x = cur ^ prev;
+
+    if (x == 0) {
+      w.write(0, 1);
+    } else {
+      unsigned int l = std::min(leading_zeros(x), 31u);
+      unsigned int t = trailing_zeros(x);
+
+      if (lead <= 64 and l >= lead and t >= trail) {
+	// fits the previous window
+	w.write(2, 2);
+	w.write(x >> trail, 64 - lead - trail);
+      } else {
+	unsigned int meaningful = 64 - l - t;
+
+	// 6 bits length, 64 is stored as 0
+	w.write(3, 2);
+	w.write(l, 5);
+	w.write(meaningful & 63, 6);
+	w.write(x >> t, meaningful);
+	lead = l;
+	trail = t;
+      }
+    }
+    prev = cur;
+  }
+}
+
+void decode_xor(const std::vector < uint8_t >& in, size_t rows, double* out)
+{
+  bit_reader r(in);
+  uint64_t prev = r.read(64);
+  unsigned int lead = 0;
+  unsigned int trail = 0;
+
+  out[0] = double_of(prev);
+  for (size_t i = 1; i < rows; ++i) {
+    if (r.read(1)) {
+      if (r.read(1)) {
+	unsigned int meaningful;
+
+	lead = r.read(5);
+	meaningful = r.read(6);
+	if (meaningful == 0) {
+	  meaningful = 64;
+	}
+	trail = 64 - lead - meaningful;
+      }
+      prev ^= r.read(64 - lead - trail) << trail;
+    }
+    out[i] = double_of(prev);
+  }
+}
+
+}
+
+const char* encoding_name(compressed_column::codec e)
+{
+  switch (e) {
+  case compressed_column::LINEAR:
+    return "linear";
+  case compressed_column::RLE:
+    return "rle";
+  case compressed_column::XOR:
+    return "xor";
+  default:
+    return "raw";
+  }
+}
+
+void compress_column(const double* data, size_t rows, compressed_column& col)
+{
+  std::vector < uint8_t > best;
+  std::vector < uint8_t > candidate;
+  size_t raw = rows * sizeof(double);
+
+  col.rows = rows;
+  col.bytes.clear();
+  col.encoding = compressed_column::RAW;
+  if (rows == 0) {
+    return;
+  }
+
+  if (encode_linear(data, rows, candidate)) {
+    col.encoding = compressed_column::LINEAR;
+    col.bytes.swap(candidate);
+    return;
+  }
+
+  candidate.clear();
+  encode_xor(data, rows, candidate);
+  if (candidate.size() < raw) {
+    col.encoding = compressed_column::XOR;
+    best.swap(candidate);
+  }
+
+  candidate.clear();
+  if (encode_rle(data, rows, best.empty() ? raw : best.size(), candidate)) {
+    col.encoding = compressed_column::RLE;
+    best.swap(candidate);
+  }
+
+  if (col.encoding == compressed_column::RAW) {
+    best.resize(raw);
+    std::memcpy(best.data(), data, raw);
+  }
+  col.bytes.swap(best);
+}
+
+void decompress_column(const compressed_column& col, double* out)
+{
+  size_t pos = 0;
+
+  if (col.rows == 0) {
+    return;
+  }
+
+  switch (col.encoding) {
+  case compressed_column::LINEAR: {
+    double first = double_of(get_u64(col.bytes, pos));
+    double step = double_of(get_u64(col.bytes, pos));
+
+    for (size_t i = 0; i < col.rows; ++i) {
+      out[i] = first + i * step;
+    }
+    break;
+  }
+  case compressed_column::RLE: {
+    size_t i = 0;
+
+    while (i < col.rows) {
+      double value = double_of(get_u64(col.bytes, pos));
+      uint64_t count = get_varint(col.bytes, pos);
+
+      if (count == 0 or count > col.rows - i) {
+	throw std::runtime_error("compressed column: bad run");
+      }
+      std::fill(out + i, out + i + count, value);
+      i += count;
+    }
+    break;
+  }
+  case compressed_column::XOR:
+    decode_xor(col.bytes, col.rows, out);
+    break;
+  default:
+    if (col.bytes.size() != col.rows * sizeof(double)) {
+      throw std::runtime_error("compressed column: bad size");
+    }
+    std::memcpy(out, col.bytes.data(), col.bytes.size());
+    break;
+  }
+}
+
+void compress_result(const transfer_block& block,
+		     std::vector < compressed_column >& columns)
+{
+  const std::vector < transfer_column >& src = block.columns();
+
+  columns.resize(src.size());
+  for (unsigned int i = 0; i < src.size(); ++i) {
+    const transfer_column& c = src[i];
+    compressed_column& col = columns[i];
+
+    col.name = column_name(c.view, c.header);
+    compress_column(reinterpret_cast < const double* >(block.data() + c.data),
+		    c.rows, col);
+    if (c.nulls) {
+      const uint8_t* bitmap = reinterpret_cast < const uint8_t* >(
+	block.data() + c.nulls);
+
+      col.nulls.assign(bitmap, bitmap + (c.rows + 7) / 8);
+    } else {
+      col.nulls.clear();
+    }
+  }
+}
@@ -0,0 +1,57 @@
+#ifndef NODE_VLE_COMPRESS_HPP
+#define NODE_VLE_COMPRESS_HPP
+
+#include "result.hpp"
+
+#include <stdint.h>
+#include <string>
+#include <vector>
+
+/*
+ * Compressed in-memory columns. Each column keeps the smallest of:
+ *
+ *   linear   an exact arithmetic progression (time columns): first value
+ *            and step only
+ *   rle      runs of identical values: value and run length (varint)
+ *   xor      Gorilla encoding: each value is XORed with the previous one
+ *            and only the meaningful bits of the result are stored
+ *   raw      plain doubles, when nothing else is smaller
+ *
+ * Values round trip bit for bit, NaN included. Null observations are
+ * NaN, with the null bitmap of the transfer block kept aside.
+ */
+
+struct compressed_column
+{
+  enum codec { RAW = 0, LINEAR = 1, RLE = 2, XOR = 3 };
+
+  compressed_column() : encoding(RAW), rows(0)
+  { }
+
+  std::string name;
+  codec encoding;
+  uint64_t rows;
+  std::vector < uint8_t > bytes;
+  std::vector < uint8_t > nulls;        // empty: no nulls
+
+  size_t size() const
+  { return bytes.size() + nulls.size(); }
+
+  // uncompressed size over compressed size
+  double ratio() const
+  { return size() ? rows * sizeof(double) / static_cast < double >(size()) :
+      1.0; }
+};
+
+const char* encoding_name(compressed_column::codec e);
+
+void compress_column(const double* data, size_t rows, compressed_column& col);
+
+// out receives col.rows values
+void decompress_column(const compressed_column& col, double* out);
+
+// compresses every column of a flattened result, named view.coupled...
+void compress_result(const transfer_block& block,
+		     std::vector < compressed_column >& columns);
+
+#endif
@@ -1 +1,2 @@
 module.exports = require('./build/Release/vle_node');
+module.exports.attach = require('./attach');
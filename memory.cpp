@@ -0,0 +1,365 @@
+#include "memory.hpp"
+
+#include <vle/value/Map.hpp>
+#include <vle/value/Matrix.hpp>
+#include <vle/value/Set.hpp>
+#include <vle/value/String.hpp>
+#include <vle/value/Table.hpp>
+#include <vle/value/Tuple.hpp>
+#include <vle/value/Xml.hpp>
+#include <vle/graph/AtomicModel.hpp>
+#include <vle/graph/CoupledModel.hpp>
+
+#include <chrono>
+#include <sstream>
+
+using namespace vle;
+
+namespace {
+
+// overheads of the heap and of the standard containers, 64 bits
+const size_t allocation = 16;
+const size_t map_node = 48 + allocation;
+const size_t value_object = 32 + allocation;
+const size_t model_object = 256 + allocation;
+const size_t vpz_base = 4096;
+
+size_t string_size(const std::string& str)
+{
+  // short strings are stored in place
+  return str.capacity() > 15 ? str.capacity() + 1 + allocation : 0;
+}
+
+size_t ports_size(const graph::ConnectionList& ports)
+{
+  size_t size = 0;
+
+  for (graph::ConnectionList::const_iterator it = ports.begin();
+       it != ports.end(); ++it) {
+    size += map_node + string_size(it->first) + it->second.size() * map_node;
+  }
+  return size;
+}
+
+size_t model_size(const graph::Model* model)
+{
+  if (not model) {
+    return 0;
+  }
+
+  size_t size = model_object + string_size(model->getName()) +
+    ports_size(model->getInputPortList()) +
+    ports_size(model->getOutputPortList());
+
+  if (model->isAtomic()) {
+    const graph::AtomicModel* atom =
+      static_cast < const graph::AtomicModel* >(model);
+
+    for (unsigned int i = 0; i < atom->conditions().size(); ++i) {
+      size += sizeof(std::string) + string_size(atom->conditions()[i]);
+    }
+    size += string_size(atom->dynamics()) + string_size(atom->observables());
+  } else {
+    const graph::CoupledModel* coupled =
+      static_cast < const graph::CoupledModel* >(model);
+    const graph::ModelList& children = coupled->getModelList();
+
+    size += ports_size(coupled->getInternalInputPortList()) +
+      ports_size(coupled->getInternalOutputPortList());
+    for (graph::ModelList::const_iterator it = children.begin();
+	 it != children.end(); ++it) {
+      size += map_node + string_size(it->first) + model_size(it->second);
+    }
+  }
+  return size;
+}
+
+}
+
+size_t value_size(const value::Value* value)
+{
+  if (not value) {
+    return 0;
+  }
+
+  size_t size = value_object;
+
+  switch (value->getType()) {
+  case value::Value::STRING:
+    size += string_size(value::toString(*value));
+    break;
+  case value::Value::XMLTYPE:
+    size += string_size(value::toXml(*value));
+    break;
+  case value::Value::SET: {
+    const value::Set& set = value->toSet();
+
+    size += set.size() * sizeof(value::Value*) + allocation;
+    for (value::Set::const_iterator it = set.begin(); it != set.end(); ++it) {
+      size += value_size(*it);
+    }
+    break;
+  }
+  case value::Value::MAP: {
+    const value::Map& map = value->toMap();
+
+    for (value::Map::const_iterator it = map.begin(); it != map.end(); ++it) {
+      size += map_node + string_size(it->first) + value_size(it->second);
+    }
+    break;
+  }
+  case value::Value::TUPLE:
+    size += value->toTuple().value().size() * sizeof(double) + allocation;
+    break;
+  case value::Value::TABLE: {
+    const value::Table& table = value->toTable();
+
+    size += table.width() * table.height() * sizeof(double) + allocation;
+    break;
+  }
+  case value::Value::MATRIX: {
+    const value::Matrix& matrix = value->toMatrix();
+
+    size += matrix.columns() * matrix.rows() * sizeof(value::Value*) +
+      allocation;
+    for (unsigned int r = 0; r < matrix.rows(); ++r) {
+      for (unsigned int c = 0; c < matrix.columns(); ++c) {
+	size += value_size(matrix.get(c, r));
+      }
+    }
+    break;
+  }
+  default:
+    break;
+  }
+  return size;
+}
+
+size_t vpz_size(const vpz::Vpz& vpz)
+{
+  const vpz::Experiment& exp = vpz.project().experiment();
+  const vpz::ConditionList& conditions = exp.conditions().conditionlist();
+  const vpz::OutputList& outputs = exp.views().outputs().outputlist();
+  size_t size = vpz_base + model_size(vpz.project().model().model());
+
+  for (vpz::ConditionList::const_iterator it = conditions.begin();
+       it != conditions.end(); ++it) {
+    const vpz::Condition::ConditionValues& ports =
+      it->second.conditionvalues();
+
+    size += map_node + string_size(it->first);
+    for (vpz::Condition::ConditionValues::const_iterator jt = ports.begin();
+	 jt != ports.end(); ++jt) {
+      size += map_node + string_size(jt->first) + value_size(jt->second);
+    }
+  }
+  for (vpz::OutputList::const_iterator it = outputs.begin();
+       it != outputs.end(); ++it) {
+    size += map_node + string_size(it->first) +
+      string_size(it->second.location()) + string_size(it->second.plugin()) +
+      string_size(it->second.package()) + value_size(it->second.data());
+  }
+  return size;
+}
+
+size_t state_size(const experiment_state& state)
+{
+  size_t size = sizeof(experiment_state);
+
+  for (experiment_state::condition_list::const_iterator it =
+	 state.conditions.begin(); it != state.conditions.end(); ++it) {
+    size += map_node + string_size(it->first);
+    for (experiment_state::port_list::const_iterator jt =
+	   it->second.begin(); jt != it->second.end(); ++jt) {
+      size += map_node + string_size(jt->first) + string_size(jt->second);
+    }
+  }
+  for (experiment_state::output_list::const_iterator it =
+	 state.outputs.begin(); it != state.outputs.end(); ++it) {
+    size += map_node + string_size(it->first) +
+      string_size(it->second.location) + string_size(it->second.plugin) +
+      string_size(it->second.package) + string_size(it->second.data);
+  }
+  return size;
+}
+
+size_t columns_size(const std::vector < compressed_column >& columns)
+{
+  size_t size = columns.capacity() * sizeof(compressed_column) + allocation;
+
+  for (unsigned int i = 0; i < columns.size(); ++i) {
+    size += string_size(columns[i].name) + columns[i].bytes.capacity() +
+      columns[i].nulls.capacity() + 2 * allocation;
+  }
+  return size;
+}
+
+/*  - - - - - - - - - - - - - --ooOoo-- - - - - - - - - - - -  */
+
+memory_accounting& memory_accounting::instance()
+{
+  static memory_accounting* accounting = new memory_accounting();
+
+  return *accounting;
+}
+
+memory_accounting::memory_accounting()
+  : _budget(0), _policy(QUEUE), _waiting(0), _blocking(0), _queued(0),
+    _rejected(0)
+{
+  for (unsigned int i = 0; i < CATEGORIES; ++i) {
+    _bytes[i] = 0;
+    _objects[i] = 0;
+  }
+}
+
+uint64_t memory_accounting::total() const
+{
+  uint64_t sum = 0;
+
+  for (unsigned int i = 0; i < CATEGORIES; ++i) {
+    sum += _bytes[i];
+  }
+  return sum;
+}
+
+void memory_accounting::attach(category c)
+{
+  std::lock_guard < std::mutex > lock(_mutex);
+
+  ++_objects[c];
+}
+
+void memory_accounting::detach(category c)
+{
+  std::lock_guard < std::mutex > lock(_mutex);
+
+  --_objects[c];
+}
+
+void memory_accounting::add(category c, int64_t bytes)
+{
+  {
+    std::lock_guard < std::mutex > lock(_mutex);
+
+    _bytes[c] += bytes;
+  }
+  if (bytes < 0) {
+    _released.notify_all();
+  }
+}
+
+void memory_accounting::set_budget(uint64_t bytes, mode policy)
+{
+  {
+    std::lock_guard < std::mutex > lock(_mutex);
+
+    _budget = bytes;
+    _policy = policy;
+  }
+  _released.notify_all();
+}
+
+void memory_accounting::reserve(uint64_t bytes, bool wait,
+				const std::atomic < bool >* cancel)
+{
+  std::unique_lock < std::mutex > lock(_mutex);
+  bool waited = false;
+
+  for (;;) {
+    if (_budget == 0 or _objects[RUNS] == 0 or
+	total() + bytes <= _budget) {
+      break;
+    }
+    if (not wait or _policy == FAIL or _blocking > 0 or
+	(cancel and cancel->load(std::memory_order_relaxed))) {
+      std::ostringstream msg;
+
+      ++_rejected;
+      msg << "memory budget exceeded: the run needs about " << bytes
+	  << " bytes, " << total() << " of " << _budget << " are in use";
+      throw memory_exceeded(msg.str());
+    }
+    if (not waited) {
+      waited = true;
+      ++_queued;
+    }
+    ++_waiting;
+    // woken by releases; the timeout only polls the cancellation
+    _released.wait_for(lock, std::chrono::milliseconds(100));
+    --_waiting;
+  }
+  _bytes[RUNS] += bytes;
+  ++_objects[RUNS];
+  if (not wait) {
+    ++_blocking;
+    lock.unlock();
+    // the waiting reservations give up
+    _released.notify_all();
+  }
+}
+
+void memory_accounting::release(uint64_t bytes, bool wait)
+{
+  {
+    std::lock_guard < std::mutex > lock(_mutex);
+
+    _bytes[RUNS] -= bytes;
+    --_objects[RUNS];
+    if (not wait) {
+      --_blocking;
+    }
+  }
+  _released.notify_all();
+}
+
+void memory_accounting::get_stats(stats& out)
+{
+  std::lock_guard < std::mutex > lock(_mutex);
+
+  for (unsigned int i = 0; i < CATEGORIES; ++i) {
+    out.bytes[i] = _bytes[i];
+    out.objects[i] = _objects[i];
+  }
+  out.total = total();
+  out.budget = _budget;
+  out.policy = _policy;
+  out.waiting = _waiting;
+  out.queued = _queued;
+  out.rejected = _rejected;
+}
+
+const char* category_name(memory_accounting::category c)
+{
+  switch (c) {
+  case memory_accounting::EXPERIMENTS:
+    return "experiments";
+  case memory_accounting::VALUES:
+    return "values";
+  case memory_accounting::SNAPSHOTS:
+    return "snapshots";
+  case memory_accounting::RESULTS:
+    return "results";
+  default:
+    return "runs";
+  }
+}
+
+void memory_reservation::acquire(uint64_t bytes, bool wait,
+				 const std::atomic < bool >* cancel)
+{
+  reset();
+  memory_accounting::instance().reserve(bytes, wait, cancel);
+  _bytes = bytes;
+  _held = true;
+  _wait = wait;
+}
+
+void memory_reservation::reset()
+{
+  if (_held) {
+    memory_accounting::instance().release(_bytes, _wait);
+    _bytes = 0;
+    _held = false;
+  }
+}
@@ -0,0 +1,140 @@
+#ifndef NODE_VLE_MEMORY_HPP
+#define NODE_VLE_MEMORY_HPP
+
+#include "compress.hpp"
+#include "snapshot.hpp"
+
+#include <vle/value/Value.hpp>
+#include <vle/vpz/Vpz.hpp>
+
+#include <atomic>
+#include <condition_variable>
+#include <mutex>
+#include <stdexcept>
+#include <stdint.h>
+#include <string>
+
+/*
+ * Native memory held by the addon: experiments, values, snapshots and
+ * compressed results owned by the wrappers, and the working set of the
+ * runs in progress. Sizes are estimates (payload and allocator overhead
+ * of the containers), close enough for V8 to weigh the wrappers and for
+ * a budget to be enforced.
+ *
+ * A run reserves its estimated size before it starts. Over the budget,
+ * the reservation waits for memory to be released (QUEUE) or fails with
+ * memory_exceeded (FAIL). A run is always admitted when no other run
+ * holds a reservation, so that an experiment larger than the budget
+ * still runs alone.
+ */
+
+size_t value_size(const vle::value::Value* value);
+
+size_t vpz_size(const vle::vpz::Vpz& vpz);
+
+size_t state_size(const experiment_state& state);
+
+size_t columns_size(const std::vector < compressed_column >& columns);
+
+class memory_exceeded : public std::runtime_error
+{
+public:
+  explicit memory_exceeded(const std::string& what)
+    : std::runtime_error(what)
+  { }
+};
+
+class memory_accounting
+{
+public:
+  enum category { EXPERIMENTS = 0, VALUES = 1, SNAPSHOTS = 2, RESULTS = 3,
+		  RUNS = 4, CATEGORIES = 5 };
+
+  enum mode { QUEUE, FAIL };
+
+  struct stats
+  {
+    uint64_t bytes[CATEGORIES];
+    uint64_t objects[CATEGORIES];       // RUNS: runs holding a reservation
+    uint64_t total;
+    uint64_t budget;                    // 0: no budget
+    mode policy;
+    unsigned int waiting;
+    uint64_t queued;                    // reservations that had to wait
+    uint64_t rejected;
+  };
+
+  static memory_accounting& instance();
+
+  // an object of the category is created or destroyed
+  void attach(category c);
+  void detach(category c);
+
+  void add(category c, int64_t bytes);
+
+  void set_budget(uint64_t bytes, mode policy);
+
+  // may wait (QUEUE) or throw memory_exceeded (FAIL); wait false fails
+  // in both modes. A cancelled wait throws memory_exceeded too.
+  //
+  // A reservation taken without waiting belongs to a synchronous caller
+  // on the main thread, which then blocks on the pool threads: while it
+  // is held, waiting reservations fail instead of queueing, since a pool
+  // thread waiting for that memory would never be given back.
+  void reserve(uint64_t bytes, bool wait,
+	       const std::atomic < bool >* cancel = 0);
+
+  // wait as given to reserve
+  void release(uint64_t bytes, bool wait);
+
+  void get_stats(stats& out);
+
+private:
+  memory_accounting();
+
+  uint64_t total() const;
+
+  std::mutex _mutex;
+  std::condition_variable _released;
+  uint64_t _bytes[CATEGORIES];
+  uint64_t _objects[CATEGORIES];
+  uint64_t _budget;
+  mode _policy;
+  unsigned int _waiting;
+  unsigned int _blocking;               // reservations of synchronous callers
+  uint64_t _queued;
+  uint64_t _rejected;
+};
+
+const char* category_name(memory_accounting::category c);
+
+// holds a reservation of the budget for the time of a run
+class memory_reservation
+{
+public:
+  memory_reservation() : _bytes(0), _held(false), _wait(false)
+  { }
+
+  memory_reservation(uint64_t bytes, bool wait,
+		     const std::atomic < bool >* cancel = 0)
+    : _bytes(0), _held(false), _wait(false)
+  { acquire(bytes, wait, cancel); }
+
+  ~memory_reservation()
+  { reset(); }
+
+  void acquire(uint64_t bytes, bool wait,
+	       const std::atomic < bool >* cancel = 0);
+
+  void reset();
+
+private:
+  memory_reservation(const memory_reservation&);
+  memory_reservation& operator=(const memory_reservation&);
+
+  uint64_t _bytes;
+  bool _held;
+  bool _wait;
+};
+
+#endif
@@ -0,0 +1,289 @@
+#include "optimizer.hpp"
+
+#include <algorithm>
+#include <cmath>
+#include <limits>
+#include <numeric>
+#include <random>
+
+namespace {
+
+double clamp01(double x)
+{
+  return x < 0 ? 0 : (x > 1 ? 1 : x);
+}
+
+std::vector < double > combine(const std::vector < double >& a,
+			       const std::vector < double >& b,
+			       double coef)
+{
+  // a + coef * (a - b), projected into the unit hypercube
+  std::vector < double > r(a.size());
+
+  for (unsigned int i = 0; i < a.size(); ++i) {
+    r[i] = clamp01(a[i] + coef * (a[i] - b[i]));
+  }
+  return r;
+}
+
+bool exhausted(const optimizer_options& options, const optimizer_result& r)
+{
+  return (options.max_iterations > 0 and
+	  r.iterations >= options.max_iterations) or
+    (options.max_evaluations > 0 and
+     r.evaluations >= options.max_evaluations);
+}
+
+}
+
+optimizer_result nelder_mead(const std::vector < double >& x0,
+			     const batch_objective& f,
+			     const optimizer_options& options,
+			     const optimizer_progress& progress)
+{
+  const unsigned int n = x0.size();
+  optimizer_result result;
+  std::vector < double > start(n);
+
+  std::transform(x0.begin(), x0.end(), start.begin(), clamp01);
+
+  point_list simplex(n + 1, start);
+  std::vector < double > values(n + 1);
+
+  for (unsigned int i = 0; i < n; ++i) {
+    simplex[i + 1][i] = start[i] + 0.1 <= 1 ? start[i] + 0.1 : start[i] - 0.1;
+  }
+  f(simplex, values);
+  result.evaluations = n + 1;
+
+  std::vector < unsigned int > order(n + 1);
+
+  for (;;) {
+    std::iota(order.begin(), order.end(), 0);
+    std::sort(order.begin(), order.end(),
+	      [&values](unsigned int a, unsigned int b)
+	      { return values[a] < values[b]; });
+
+    const unsigned int best = order.front();
+    const unsigned int worst = order.back();
+    const unsigned int second = order[n - 1];
+
+    result.x = simplex[best];
+    result.value = values[best];
+    if (std::abs(values[worst] - values[best]) <= options.tolerance) {
+      result.converged = true;
+      break;
+    }
+    if (exhausted(options, result)) {
+      break;
+    }
+
+    std::vector < double > centroid(n, 0.0);
+
+    for (unsigned int i = 0; i <= n; ++i) {
+      if (i != worst) {
+	for (unsigned int j = 0; j < n; ++j) {
+	  centroid[j] += simplex[i][j] / n;
+	}
+      }
+    }
+
+    // the four candidate moves are evaluated speculatively in one batch
+    // so that a single iteration costs one parallel simulation round
+    point_list moves;
+    std::vector < double > fm(4);
+
+    moves.push_back(combine(centroid, simplex[worst], 1.0));  // reflection
+    moves.push_back(combine(centroid, simplex[worst], 2.0));  // expansion
+    moves.push_back(combine(centroid, simplex[worst], 0.5));  // outside
+    moves.push_back(combine(centroid, simplex[worst], -0.5)); // inside
+    f(moves, fm);
+    result.evaluations += 4;
+
+    int accepted = -1;
+
+    if (fm[0] < values[best]) {
+      accepted = fm[1] < fm[0] ? 1 : 0;
+    } else if (fm[0] < values[second]) {
+      accepted = 0;
+    } else if (fm[0] < values[worst]) {
+      if (fm[2] <= fm[0]) {
+	accepted = 2;
+      }
+    } else if (fm[3] < values[worst]) {
+      accepted = 3;
+    }
+
+    if (accepted >= 0) {
+      simplex[worst] = moves[accepted];
+      values[worst] = fm[accepted];
+    } else {
+      point_list shrunk;
+      std::vector < double > fs(n);
+
+      for (unsigned int i = 0; i <= n; ++i) {
+	if (i != best) {
+	  shrunk.push_back(combine(simplex[best], simplex[i], -0.5));
+	}
+      }
+      f(shrunk, fs);
+      result.evaluations += n;
+      for (unsigned int i = 0, k = 0; i <= n; ++i) {
+	if (i != best) {
+	  simplex[i] = shrunk[k];
+	  values[i] = fs[k];
+	  ++k;
+	}
+      }
+    }
+
+    ++result.iterations;
+    if (progress) {
+      unsigned int b = std::min_element(values.begin(), values.end()) -
+	values.begin();
+      optimizer_result current(result);
+
+      current.x = simplex[b];
+      current.value = values[b];
+      progress(current);
+    }
+  }
+  return result;
+}
+
+optimizer_result cmaes(const std::vector < double >& x0,
+		       const batch_objective& f,
+		       const optimizer_options& options,
+		       const optimizer_progress& progress)
+{
+  // separable CMA-ES (diagonal covariance, Ros & Hansen 2008): the
+  // number of calibrated parameters is small and the objective is a
+  // whole simulation, so the full eigen decomposition is not worth it.
+  const unsigned int n = x0.size();
+  // mu = lambda / 2 parents, at least one
+  const unsigned int lambda = options.population > 0 ?
+    std::max(2u, options.population) :
+    4 + static_cast < unsigned int >(3 * std::log(static_cast < double >(n)));
+  const unsigned int mu = lambda / 2;
+  std::vector < double > weights(mu);
+
+  for (unsigned int i = 0; i < mu; ++i) {
+    weights[i] = std::log(mu + 0.5) - std::log(i + 1.0);
+  }
+
+  const double wsum = std::accumulate(weights.begin(), weights.end(), 0.0);
+  double w2sum = 0;
+
+  for (unsigned int i = 0; i < mu; ++i) {
+    weights[i] /= wsum;
+    w2sum += weights[i] * weights[i];
+  }
+
+  const double mueff = 1.0 / w2sum;
+  const double cs = (mueff + 2) / (n + mueff + 5);
+  const double ds = 1 + 2 * std::max(0.0, std::sqrt((mueff - 1) / (n + 1)) - 1)
+    + cs;
+  const double cc = (4 + mueff / n) / (n + 4 + 2 * mueff / n);
+  const double c1 = 2 / ((n + 1.3) * (n + 1.3) + mueff);
+  const double cmu = std::min(1 - c1, (n + 2) / 3.0 *
+			      2 * (mueff - 2 + 1 / mueff) /
+			      ((n + 2) * (n + 2) + mueff));
+  const double chin = std::sqrt(static_cast < double >(n)) *
+    (1 - 1.0 / (4 * n) + 1.0 / (21.0 * n * n));
+
+  std::mt19937 gen(options.seed);
+  std::normal_distribution < double > normal(0.0, 1.0);
+  std::vector < double > mean(x0), diag(n, 1.0), pc(n, 0.0), ps(n, 0.0);
+  double sigma = 0.3;
+  optimizer_result result;
+
+  result.x = x0;
+  result.value = std::numeric_limits < double >::infinity();
+
+  for (;;) {
+    point_list xs(lambda, std::vector < double >(n));
+    point_list ys(lambda, std::vector < double >(n));
+    std::vector < double > fx(lambda);
+
+    for (unsigned int k = 0; k < lambda; ++k) {
+      for (unsigned int i = 0; i < n; ++i) {
+	xs[k][i] = clamp01(mean[i] + sigma * std::sqrt(diag[i]) * normal(gen));
+	ys[k][i] = (xs[k][i] - mean[i]) / sigma;
+      }
+    }
+    f(xs, fx);
+    result.evaluations += lambda;
+    ++result.iterations;
+
+    std::vector < unsigned int > order(lambda);
+
+    std::iota(order.begin(), order.end(), 0);
+    std::sort(order.begin(), order.end(),
+	      [&fx](unsigned int a, unsigned int b)
+	      { return fx[a] < fx[b]; });
+
+    if (fx[order[0]] < result.value) {
+      result.value = fx[order[0]];
+      result.x = xs[order[0]];
+    }
+
+    std::vector < double > yw(n, 0.0);
+
+    for (unsigned int k = 0; k < mu; ++k) {
+      for (unsigned int i = 0; i < n; ++i) {
+	yw[i] += weights[k] * ys[order[k]][i];
+      }
+    }
+
+    double psnorm = 0;
+
+    for (unsigned int i = 0; i < n; ++i) {
+      mean[i] = clamp01(mean[i] + sigma * yw[i]);
+      ps[i] = (1 - cs) * ps[i] +
+	std::sqrt(cs * (2 - cs) * mueff) * yw[i] / std::sqrt(diag[i]);
+      psnorm += ps[i] * ps[i];
+    }
+    psnorm = std::sqrt(psnorm);
+
+    const bool hsig = psnorm /
+      std::sqrt(1 - std::pow(1 - cs, 2.0 * result.iterations)) / chin <
+      1.4 + 2.0 / (n + 1);
+
+    for (unsigned int i = 0; i < n; ++i) {
+      double rankmu = 0;
+
+      pc[i] = (1 - cc) * pc[i] +
+	(hsig ? std::sqrt(cc * (2 - cc) * mueff) * yw[i] : 0.0);
+      for (unsigned int k = 0; k < mu; ++k) {
+	rankmu += weights[k] * ys[order[k]][i] * ys[order[k]][i];
+      }
+      diag[i] = (1 - c1 - cmu) * diag[i] +
+	c1 * (pc[i] * pc[i] + (hsig ? 0.0 : cc * (2 - cc) * diag[i])) +
+	cmu * rankmu;
+    }
+    sigma *= std::exp((cs / ds) * (psnorm / chin - 1));
+
+    if (progress) {
+      progress(result);
+    }
+
+    double spread = fx[order[lambda - 1]] - fx[order[0]];
+    double maxstd = 0;
+
+    for (unsigned int i = 0; i < n; ++i) {
+      maxstd = std::max(maxstd, sigma * std::sqrt(diag[i]));
+    }
+    // infinite values (failed simulations) never count as converged,
+    // inf - inf is NaN and would fail the test anyway
+    if (std::isfinite(result.value) and std::isfinite(spread) and
+	(std::abs(spread) <= options.tolerance or
+	 maxstd <= options.tolerance)) {
+      result.converged = true;
+      break;
+    }
+    if (exhausted(options, result)) {
+      break;
+    }
+  }
+  return result;
+}
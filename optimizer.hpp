@@ -0,0 +1,61 @@
+#ifndef NODE_VLE_OPTIMIZER_HPP
+#define NODE_VLE_OPTIMIZER_HPP
+
+#include <functional>
+#include <string>
+#include <vector>
+
+/*
+ * Derivative free optimizers used by the calibration loop. Both work in
+ * the unit hypercube [0, 1]^n and ask the caller to evaluate whole
+ * batches of points so that the simulations of a batch can run in
+ * parallel.
+ */
+
+struct optimizer_options
+{
+  optimizer_options()
+    : max_iterations(100), max_evaluations(0), tolerance(1e-6),
+      seed(1), population(0)
+  { }
+
+  unsigned int max_iterations;  // 0: no limit
+  unsigned int max_evaluations; // 0: no limit
+  double tolerance;
+  unsigned int seed;
+  unsigned int population;      // cmaes lambda, at least 2, 0: default
+};
+
+struct optimizer_result
+{
+  optimizer_result()
+    : value(0), iterations(0), evaluations(0), converged(false)
+  { }
+
+  std::vector < double > x;
+  double value;
+  unsigned int iterations;
+  unsigned int evaluations;
+  bool converged;
+};
+
+typedef std::vector < std::vector < double > > point_list;
+
+// evaluate every point of the batch, values[i] receives f(points[i])
+typedef std::function < void (const point_list& points,
+			      std::vector < double >& values) > batch_objective;
+
+// called after each iteration with the best point found so far
+typedef std::function < void (const optimizer_result& current) > optimizer_progress;
+
+optimizer_result nelder_mead(const std::vector < double >& x0,
+			     const batch_objective& f,
+			     const optimizer_options& options,
+			     const optimizer_progress& progress);
+
+optimizer_result cmaes(const std::vector < double >& x0,
+		       const batch_objective& f,
+		       const optimizer_options& options,
+		       const optimizer_progress& progress);
+
+#endif
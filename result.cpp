@@ -0,0 +1,305 @@
+#include "result.hpp"
+
+#include <cmath>
+#include <cstring>
+#include <new>
+#include <stdint.h>
+#include <limits>
+#include <sstream>
+
+using namespace vle;
+
+namespace {
+
+size_t align8(size_t size)
+{
+  return (size + 7) & ~static_cast < size_t >(7);
+}
+
+bool is_number(const value::Value* v)
+{
+  return v and (v->isDouble() or v->isInteger() or v->isBoolean());
+}
+
+}
+
+void split(const std::string& str, char delim, std::vector < std::string >& vec)
+{
+  std::stringstream ss;
+  std::string item;
+
+  ss.str(str);
+  while (getline(ss, item, delim)) {
+    vec.push_back(item);
+  }
+}
+
+void build_path(const std::string& str, std::vector < std::string >& path)
+{
+  // format: (,coupled_model)*:atomic_model.port
+  split(str, ',', path);
+  if (path[0].empty()) {
+    std::vector < std::string > path2;
+    std::vector < std::string > path3;
+
+    path.erase(path.begin());
+    split(path[path.size() - 1], ':', path2);
+    split(path2[path2.size() - 1], '.', path3);
+    path.pop_back();
+    path.push_back(path2[0]);
+    path.push_back(path3[0]);
+    path.push_back(path3[1]);
+  } else {
+    std::vector < std::string > path2;
+    std::vector < std::string > path3;
+
+    split(path[0], ':', path2);
+    split(path2[path2.size() - 1], '.', path3);
+    path.pop_back();
+    path.push_back(path3[0]);
+    path.push_back(path3[1]);
+  }
+}
+
+std::string column_name(const std::string& view, const std::string& header)
+{
+  std::string name(view);
+
+  if (header == "time") {
+    name += ".time";
+  } else {
+    std::vector < std::string > path;
+
+    build_path(header, path);
+    for (unsigned int i = 0; i < path.size(); ++i) {
+      name += "." + path[i];
+    }
+  }
+  return name;
+}
+
+double to_double(const value::Value* value)
+{
+  if (value) {
+    switch (value->getType()) {
+    case value::Value::DOUBLE:
+      return value::toDouble(*value);
+    case value::Value::INTEGER:
+      return value::toInteger(*value);
+    case value::Value::BOOLEAN:
+      return value::toBoolean(*value) ? 1.0 : 0.0;
+    default:
+      break;
+    }
+  }
+  return std::numeric_limits < double >::quiet_NaN();
+}
+
+const value::Matrix* find_column(const value::Map& out,
+				 const std::string& name,
+				 unsigned int& column)
+{
+  for (value::Map::const_iterator it = out.begin(); it != out.end(); ++it) {
+    if (name.compare(0, it->first.size() + 1, it->first + ".") == 0) {
+      const value::Matrix& matrix = it->second->toMatrix();
+
+      for (unsigned int c = 0; c < matrix.columns(); ++c) {
+	if (column_name(it->first, matrix.getString(c, 0)) == name) {
+	  column = c;
+	  return &matrix;
+	}
+      }
+    }
+  }
+  return 0;
+}
+
+void select_times(const std::vector < double >& times,
+		  const view_filter& filter, std::vector < row_sample >& rows)
+{
+  std::vector < unsigned int > kept;
+
+  for (unsigned int i = 0; i < times.size(); ++i) {
+    if (not std::isnan(times[i]) and times[i] >= filter.begin and
+	times[i] <= filter.end) {
+      kept.push_back(i);
+    }
+  }
+
+  if (filter.grid > 0) {
+    if (kept.empty()) {
+      return;
+    }
+
+    double first = std::isinf(filter.begin) ? times[kept.front()] :
+      filter.begin;
+    double last = times[kept.back()];
+    unsigned int k = 0;
+
+    for (unsigned int n = 0; first + n * filter.grid <= last; ++n) {
+      double g = first + n * filter.grid;
+
+      while (k + 1 < kept.size() and times[kept[k + 1]] <= g) {
+	++k;
+      }
+      if (times[kept[k]] > g) {
+	continue;
+      }
+
+      row_sample s = { kept[k], kept[k], 0.0, g, true };
+
+      if (filter.linear and k + 1 < kept.size()) {
+	double ta = times[kept[k]];
+	double tb = times[kept[k + 1]];
+
+	s.next = kept[k + 1];
+	s.weight = tb > ta ? (g - ta) / (tb - ta) : 0.0;
+      }
+      rows.push_back(s);
+    }
+  } else {
+    for (unsigned int k = 0; k < kept.size(); k += filter.every) {
+      row_sample s = { kept[k], kept[k], 0.0, 0.0, false };
+
+      rows.push_back(s);
+    }
+  }
+}
+
+void select_rows(const value::Matrix& matrix, unsigned int nbline,
+		 const view_filter* filter, std::vector < row_sample >& rows)
+{
+  if (not filter or not filter->active()) {
+    for (unsigned int i = 1; i < nbline; ++i) {
+      row_sample s = { i, i, 0.0, 0.0, false };
+
+      rows.push_back(s);
+    }
+    return;
+  }
+
+  unsigned int c = 0;
+
+  while (c < matrix.columns() and matrix.getString(c, 0) != "time") {
+    ++c;
+  }
+  if (c == matrix.columns()) {
+    return;
+  }
+
+  value::ConstVectorView t = matrix.column(c);
+  std::vector < double > times;
+  size_t first = rows.size();
+
+  for (unsigned int i = 1; i < nbline; ++i) {
+    times.push_back(to_double(t[i]));
+  }
+  select_times(times, *filter, rows);
+  // the header is row 0 of the matrix
+  for (size_t i = first; i < rows.size(); ++i) {
+    ++rows[i].row;
+    ++rows[i].next;
+  }
+}
+
+void transfer_block::fill(const value::Map& out, const view_filters* filters)
+{
+  std::vector < std::vector < row_sample > > samples;
+  std::vector < const value::Matrix* > matrices;
+  std::vector < unsigned int > owners;
+  std::vector < unsigned int > indexes;
+
+  std::free(_data);
+  _data = 0;
+  _size = 0;
+  _columns.clear();
+
+  // first pass: layout, rows kept by the filters and nullable columns
+  for (value::Map::const_iterator it = out.begin(); it != out.end(); ++it) {
+    const value::Matrix& matrix = it->second->toMatrix();
+    const view_filter* filter = 0;
+
+    if (filters) {
+      view_filters::const_iterator f = filters->find(it->first);
+
+      if (f != filters->end()) {
+	filter = &f->second;
+      }
+    }
+    samples.push_back(std::vector < row_sample >());
+    matrices.push_back(&matrix);
+    select_rows(matrix, matrix.rows(), filter, samples.back());
+
+    const std::vector < row_sample >& rows = samples.back();
+
+    for (unsigned int c = 0; c < matrix.columns(); ++c) {
+      transfer_column col;
+      value::ConstVectorView t = matrix.column(c);
+      bool nullable = false;
+      bool time;
+
+      col.view = it->first;
+      col.header = matrix.getString(c, 0);
+      if (col.header == "time") {
+	col.path.push_back(col.header);
+      } else {
+	build_path(col.header, col.path);
+      }
+      time = col.header == "time";
+      col.rows = rows.size();
+      col.data = _size;
+      _size += align8(col.rows * sizeof(double));
+      for (unsigned int r = 0; r < rows.size() and not nullable; ++r) {
+	nullable = not (time and rows[r].resampled) and
+	  not is_number(t[rows[r].row]);
+      }
+      if (nullable) {
+	col.nulls = _size;
+	_size += align8((col.rows + 7) / 8);
+      } else {
+	col.nulls = 0;
+      }
+      _columns.push_back(col);
+      owners.push_back(samples.size() - 1);
+      indexes.push_back(c);
+    }
+  }
+
+  // offset 0 marks a column without nulls, the block never starts with
+  // a bitmap since every column has its doubles first
+  _data = static_cast < char* >(std::calloc(_size ? _size : 1, 1));
+  if (not _data) {
+    throw std::bad_alloc();
+  }
+
+  // second pass: copy
+  for (unsigned int i = 0; i < _columns.size(); ++i) {
+    const transfer_column& col = _columns[i];
+    const std::vector < row_sample >& rows = samples[owners[i]];
+    value::ConstVectorView t = matrices[owners[i]]->column(indexes[i]);
+    double* data = reinterpret_cast < double* >(_data + col.data);
+    uint8_t* bitmap = col.nulls ?
+      reinterpret_cast < uint8_t* >(_data + col.nulls) : 0;
+    bool time = col.header == "time";
+
+    for (unsigned int r = 0; r < rows.size(); ++r) {
+      const row_sample& s = rows[r];
+
+      if (time and s.resampled) {
+	data[r] = s.time;
+	continue;
+      }
+      data[r] = to_double(t[s.row]);
+      if (s.weight > 0) {
+	double b = to_double(t[s.next]);
+
+	if (not std::isnan(data[r]) and not std::isnan(b)) {
+	  data[r] = (1 - s.weight) * data[r] + s.weight * b;
+	}
+      }
+      if (bitmap and not is_number(t[s.row])) {
+	bitmap[r / 8] |= 1 << (r % 8);
+      }
+    }
+  }
+}
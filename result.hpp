@@ -0,0 +1,133 @@
+#ifndef NODE_VLE_RESULT_HPP
+#define NODE_VLE_RESULT_HPP
+
+#include <vle/value/Map.hpp>
+#include <vle/value/Matrix.hpp>
+
+#include <cstdlib>
+#include <limits>
+#include <map>
+#include <string>
+#include <vector>
+
+/*
+ * Native view of a simulation result: the value::Map of the storage
+ * plugins, one value::Matrix per view, with the column headers in the
+ * first row.
+ */
+
+void split(const std::string& str, char delim, std::vector < std::string >& vec);
+
+void build_path(const std::string& str, std::vector < std::string >& path);
+
+// column name of a storage matrix header: view.coupled.atomic.port
+std::string column_name(const std::string& view, const std::string& header);
+
+// NaN for null and non numeric values
+double to_double(const vle::value::Value* value);
+
+const vle::value::Matrix* find_column(const vle::value::Map& out,
+				      const std::string& name,
+				      unsigned int& column);
+
+// rows of a view kept by the conversion: a time window, one row every
+// k rows, or a resampling on a regular grid
+struct view_filter
+{
+  view_filter()
+    : begin(-std::numeric_limits < double >::infinity()),
+      end(std::numeric_limits < double >::infinity()),
+      every(1), grid(0), linear(false)
+  { }
+
+  bool active() const
+  {
+    return every > 1 or grid > 0 or
+      begin != -std::numeric_limits < double >::infinity() or
+      end != std::numeric_limits < double >::infinity();
+  }
+
+  double begin;
+  double end;
+  unsigned int every;
+  double grid;
+  bool linear;
+};
+
+struct row_sample
+{
+  unsigned int row;
+  unsigned int next;
+  double weight;    // value = (1 - weight) * v[row] + weight * v[next]
+  double time;
+  bool resampled;
+};
+
+typedef std::map < std::string, view_filter > view_filters;
+
+// indexes of the times kept by an active filter, NaN times excluded
+void select_times(const std::vector < double >& times,
+		  const view_filter& filter, std::vector < row_sample >& rows);
+
+// rows 1 to nbline - 1 of the matrix kept by the filter (all when filter
+// is null or inactive)
+void select_rows(const vle::value::Matrix& matrix, unsigned int nbline,
+		 const view_filter* filter, std::vector < row_sample >& rows);
+
+/*
+ * Flat copy of a result, built on a worker thread so that the main
+ * thread only has to wrap it: one malloc'd block holding the kept rows
+ * of every column as doubles (null and non numeric observations are
+ * NaN), each column followed by its null bitmap when it has nulls.
+ * Every block is aligned on 8 bytes.
+ */
+
+struct transfer_column
+{
+  std::string view;
+  std::string header;
+  std::vector < std::string > path;     // "time" or the model path and port
+  size_t rows;
+  size_t data;                          // byte offset of the doubles
+  size_t nulls;                         // byte offset of the bitmap, 0: none
+};
+
+class transfer_block
+{
+public:
+  transfer_block() : _data(0), _size(0)
+  { }
+
+  ~transfer_block()
+  { std::free(_data); }
+
+  char* data() const
+  { return _data; }
+
+  size_t size() const
+  { return _size; }
+
+  const std::vector < transfer_column >& columns() const
+  { return _columns; }
+
+  // the caller becomes the owner of the block, to be freed with free()
+  char* release()
+  {
+    char* data = _data;
+
+    _data = 0;
+    return data;
+  }
+
+  void fill(const vle::value::Map& out, const view_filters* filters);
+
+private:
+  transfer_block(const transfer_block&);
+  transfer_block& operator=(const transfer_block&);
+
+  char* _data;
+  size_t _size;
+  std::vector < transfer_column > _columns;
+};
+
+#endif
@@ -0,0 +1,238 @@
+#include "scheduler.hpp"
+#include "trace.hpp"
+
+#include <algorithm>
+
+scheduler& scheduler::instance()
+{
+  static scheduler* pool = new scheduler(
+    std::max(1u, std::thread::hardware_concurrency()));
+
+  return *pool;
+}
+
+scheduler::scheduler(unsigned int threads)
+  : _next_id(0), _completed(0), _cancelled(0), _placement_epoch(0)
+{
+  for (unsigned int i = 0; i < PRIORITIES; ++i) {
+    _started[i] = 0;
+    _wait_total[i] = 0;
+    _wait_max[i] = 0;
+  }
+  for (unsigned int i = 0; i < threads; ++i) {
+    _threads.push_back(std::thread(&scheduler::loop, this, i));
+    _threads.back().detach();
+  }
+}
+
+scheduler::~scheduler()
+{ }
+
+uint64_t scheduler::submit(priority level, const std::string& tenant,
+			   const task& work, const completion& done)
+{
+  job* j = new job();
+
+  j->level = level;
+  j->tenant = tenant;
+  j->work = work;
+  j->done = done;
+  j->queued = clock::now();
+  j->cancelled = false;
+
+  {
+    std::lock_guard < std::mutex > lock(_mutex);
+
+    j->id = ++_next_id;
+    _queues[level].push_back(j);
+    ++_tenants[tenant].queued;
+  }
+  _ready.notify_one();
+  return j->id;
+}
+
+bool scheduler::cancel(uint64_t id)
+{
+  job* queued = 0;
+
+  {
+    std::lock_guard < std::mutex > lock(_mutex);
+    std::map < uint64_t, job* >::iterator it = _running.find(id);
+
+    if (it != _running.end()) {
+      it->second->cancelled = true;
+      return true;
+    }
+    for (unsigned int i = 0; i < PRIORITIES and not queued; ++i) {
+      for (std::deque < job* >::iterator jt = _queues[i].begin();
+	   jt != _queues[i].end(); ++jt) {
+	if ((*jt)->id == id) {
+	  queued = *jt;
+	  _queues[i].erase(jt);
+	  --_tenants[queued->tenant].queued;
+	  ++_cancelled;
+	  break;
+	}
+      }
+    }
+  }
+  if (queued) {
+    // a quota slot may not matter any more for the jobs behind it
+    _ready.notify_one();
+    queued->done(true);
+    delete queued;
+  }
+  return queued != 0;
+}
+
+void scheduler::set_quota(const std::string& tenant, unsigned int max_running)
+{
+  {
+    std::lock_guard < std::mutex > lock(_mutex);
+
+    _tenants[tenant].quota = max_running;
+  }
+  _ready.notify_all();
+}
+
+void scheduler::set_placement(const placement& where)
+{
+  std::lock_guard < std::mutex > lock(_mutex);
+
+  _placement = where;
+  ++_placement_epoch;
+}
+
+void scheduler::get_stats(stats& out)
+{
+  std::lock_guard < std::mutex > lock(_mutex);
+
+  out.threads = _threads.size();
+  out.running = _running.size();
+  for (unsigned int i = 0; i < PRIORITIES; ++i) {
+    out.queued[i] = _queues[i].size();
+    out.started[i] = _started[i];
+    out.wait_total[i] = _wait_total[i];
+    out.wait_max[i] = _wait_max[i];
+  }
+  out.completed = _completed;
+  out.cancelled = _cancelled;
+  out.tenants = _tenants;
+  out.policy = _placement.kind();
+  out.nodes = _nodes;
+}
+
+scheduler::job* scheduler::next_job()
+{
+  for (unsigned int i = 0; i < PRIORITIES; ++i) {
+    for (std::deque < job* >::iterator it = _queues[i].begin();
+	 it != _queues[i].end(); ++it) {
+      tenant_stats& tenant = _tenants[(*it)->tenant];
+
+      if (tenant.quota == 0 or tenant.running < tenant.quota) {
+	job* j = *it;
+	double wait = std::chrono::duration < double, std::milli >(
+	  clock::now() - j->queued).count();
+
+	_queues[i].erase(it);
+	--tenant.queued;
+	++tenant.running;
+	++_started[i];
+	_wait_total[i] += wait;
+	_wait_max[i] = std::max(_wait_max[i], wait);
+	_running[j->id] = j;
+	return j;
+      }
+    }
+  }
+  return 0;
+}
+
+void scheduler::loop(unsigned int index)
+{
+  uint64_t epoch = 0;
+
+  for (;;) {
+    job* j;
+    bool move = false;
+    int cpu = -1;
+
+    {
+      std::unique_lock < std::mutex > lock(_mutex);
+
+      _ready.wait(lock, [this, &j]() { return (j = next_job()) != 0; });
+      if (epoch != _placement_epoch) {
+	epoch = _placement_epoch;
+	move = true;
+	cpu = _placement.cpu(index);
+      }
+    }
+    if (move) {
+      pin_thread(cpu);
+    }
+    trace_thread_name("scheduler");
+
+    bool cancelled = false;
+
+    try {
+      cancelled = j->work(j->cancelled);
+    } catch(...) {
+    }
+
+    int node = current_node();
+
+    {
+      std::lock_guard < std::mutex > lock(_mutex);
+
+      _running.erase(j->id);
+      --_tenants[j->tenant].running;
+      if (cancelled) {
+	++_cancelled;
+      } else {
+	++_completed;
+	++_nodes[node];
+      }
+    }
+    // the finished job may have freed a quota slot
+    _ready.notify_all();
+    j->done(cancelled);
+    delete j;
+  }
+}
+
+/*  - - - - - - - - - - - - - --ooOoo-- - - - - - - - - - - -  */
+
+job_group::job_group(scheduler::priority level, const std::string& tenant)
+  : _level(level), _tenant(tenant), _pending(0)
+{ }
+
+job_group::~job_group()
+{
+  wait();
+}
+
+void job_group::run(const std::function < void () >& work)
+{
+  {
+    std::lock_guard < std::mutex > lock(_mutex);
+
+    ++_pending;
+  }
+  scheduler::instance().submit(
+    _level, _tenant,
+    [work](const std::atomic < bool >&) { work(); return false; },
+    [this](bool) {
+      std::lock_guard < std::mutex > lock(_mutex);
+
+      if (--_pending == 0) {
+	_done.notify_all();
+      }
+    });
+}
+
+void job_group::wait()
+{
+  std::unique_lock < std::mutex > lock(_mutex);
+
+  _done.wait(lock, [this]() { return _pending == 0; });
+}
@@ -0,0 +1,158 @@
+#ifndef NODE_VLE_SCHEDULER_HPP
+#define NODE_VLE_SCHEDULER_HPP
+
+#include "affinity.hpp"
+
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <deque>
+#include <functional>
+#include <map>
+#include <mutex>
+#include <stdint.h>
+#include <string>
+#include <thread>
+#include <vector>
+
+/*
+ * Process wide job scheduler shared by every Vle instance: a fixed pool
+ * of threads sized to the machine, three priority classes served in
+ * order, and an optional limit on the jobs a tenant runs at once. A job
+ * queued behind a tenant at its quota does not block the jobs of the
+ * other tenants. A placement pins the pool threads, each one moves
+ * before starting its next job.
+ */
+
+class scheduler
+{
+public:
+  enum priority { INTERACTIVE = 0, NORMAL = 1, BATCH = 2, PRIORITIES = 3 };
+
+  // runs on a pool thread, cancelled is raised by cancel() and must be
+  // polled by long tasks; returns true when it stopped on it, a cancel
+  // arriving once the work is done does not count
+  typedef std::function < bool (const std::atomic < bool >& cancelled) > task;
+
+  // called once per job: on the pool thread after the task with what it
+  // returned, or on the thread calling cancel() when the job was still
+  // queued
+  typedef std::function < void (bool cancelled) > completion;
+
+  struct tenant_stats
+  {
+    tenant_stats() : queued(0), running(0), quota(0)
+    { }
+
+    unsigned int queued;
+    unsigned int running;
+    unsigned int quota;         // 0: no limit
+  };
+
+  struct stats
+  {
+    unsigned int threads;
+    unsigned int running;
+    unsigned int queued[PRIORITIES];
+    uint64_t started[PRIORITIES];
+    double wait_total[PRIORITIES];      // ms, jobs started so far
+    double wait_max[PRIORITIES];
+    uint64_t completed;
+    uint64_t cancelled;
+    std::map < std::string, tenant_stats > tenants;
+    placement::policy policy;
+    std::map < int, uint64_t > nodes;   // jobs completed on each node
+  };
+
+  static scheduler& instance();
+
+  uint64_t submit(priority level, const std::string& tenant,
+		  const task& work, const completion& done);
+
+  // false when the job is unknown or already finished
+  bool cancel(uint64_t id);
+
+  void set_quota(const std::string& tenant, unsigned int max_running);
+
+  void set_placement(const placement& where);
+
+  void get_stats(stats& out);
+
+  unsigned int size() const
+  { return _threads.size(); }
+
+private:
+  typedef std::chrono::steady_clock clock;
+
+  struct job
+  {
+    uint64_t id;
+    priority level;
+    std::string tenant;
+    task work;
+    completion done;
+    clock::time_point queued;
+    std::atomic < bool > cancelled;
+  };
+
+  explicit scheduler(unsigned int threads);
+
+  // never destroyed: pool threads may still run at exit
+  ~scheduler();
+  scheduler(const scheduler&);
+  scheduler& operator=(const scheduler&);
+
+  void loop(unsigned int index);
+
+  // first job of the highest priority whose tenant is under its quota,
+  // removed from its queue; 0 when none can start
+  job* next_job();
+
+  std::mutex _mutex;
+  std::condition_variable _ready;
+  std::vector < std::thread > _threads;
+  std::deque < job* > _queues[PRIORITIES];
+  std::map < uint64_t, job* > _running;
+  std::map < std::string, tenant_stats > _tenants;
+  uint64_t _next_id;
+  uint64_t _started[PRIORITIES];
+  double _wait_total[PRIORITIES];
+  double _wait_max[PRIORITIES];
+  uint64_t _completed;
+  uint64_t _cancelled;
+  placement _placement;
+  uint64_t _placement_epoch;
+  std::map < int, uint64_t > _nodes;
+};
+
+/*
+ * Jobs of the pool that a blocking call waits for: the parallel runners
+ * (run_manager_thread, run_manager_pipeline, calibrate) run on the pool
+ * instead of threads of their own. The destructor waits too, so that no
+ * job outlives the state it refers to.
+ */
+
+class job_group
+{
+public:
+  explicit job_group(scheduler::priority level = scheduler::NORMAL,
+		     const std::string& tenant = std::string());
+  ~job_group();
+
+  void run(const std::function < void () >& work);
+
+  // until every job of the group has run or was cancelled
+  void wait();
+
+private:
+  job_group(const job_group&);
+  job_group& operator=(const job_group&);
+
+  scheduler::priority _level;
+  std::string _tenant;
+  std::mutex _mutex;
+  std::condition_variable _done;
+  unsigned int _pending;
+};
+
+#endif
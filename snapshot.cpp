@@ -0,0 +1,836 @@
+#include "snapshot.hpp"
+
+#include <vle/value/Boolean.hpp>
+#include <vle/value/Double.hpp>
+#include <vle/value/Integer.hpp>
+#include <vle/value/Map.hpp>
+#include <vle/value/Matrix.hpp>
+#include <vle/value/Null.hpp>
+#include <vle/value/Set.hpp>
+#include <vle/value/String.hpp>
+#include <vle/value/Table.hpp>
+#include <vle/value/Tuple.hpp>
+#include <vle/value/Xml.hpp>
+#include <vle/graph/AtomicModel.hpp>
+#include <vle/graph/CoupledModel.hpp>
+
+#include <cstring>
+#include <fstream>
+#include <iterator>
+#include <list>
+#include <memory>
+#include <stdexcept>
+
+using namespace vle;
+
+namespace {
+
+const char magic[8] = { 'V', 'L', 'E', 'V', 'P', 'Z', 'S', '\0' };
+const uint32_t version = 1;
+
+enum model_kind { MODEL_NONE = 0, MODEL_ATOMIC = 1, MODEL_COUPLED = 2 };
+
+void write_strings(binary_writer& out, const std::vector < std::string >& lst)
+{
+  out.u32(lst.size());
+  for (unsigned int i = 0; i < lst.size(); ++i) {
+    out.str(lst[i]);
+  }
+}
+
+std::vector < std::string > read_strings(binary_reader& in)
+{
+  std::vector < std::string > lst(in.u32());
+
+  for (unsigned int i = 0; i < lst.size(); ++i) {
+    lst[i] = in.str();
+  }
+  return lst;
+}
+
+void write_ports(binary_writer& out, const graph::ConnectionList& ports)
+{
+  out.u32(ports.size());
+  for (graph::ConnectionList::const_iterator it = ports.begin();
+       it != ports.end(); ++it) {
+    out.str(it->first);
+  }
+}
+
+void write_model(binary_writer& out, const graph::Model* model)
+{
+  if (not model) {
+    out.u8(MODEL_NONE);
+    return;
+  }
+
+  out.u8(model->isAtomic() ? MODEL_ATOMIC : MODEL_COUPLED);
+  out.str(model->getName());
+  out.u32(model->x());
+  out.u32(model->y());
+  out.u32(model->width());
+  out.u32(model->height());
+  write_ports(out, model->getInputPortList());
+  write_ports(out, model->getOutputPortList());
+
+  if (model->isAtomic()) {
+    const graph::AtomicModel* atom =
+      static_cast < const graph::AtomicModel* >(model);
+
+    write_strings(out, atom->conditions());
+    out.str(atom->dynamics());
+    out.str(atom->observables());
+    return;
+  }
+
+  const graph::CoupledModel* coupled =
+    static_cast < const graph::CoupledModel* >(model);
+  const graph::ModelList& children = coupled->getModelList();
+
+  out.u32(children.size());
+  for (graph::ModelList::const_iterator it = children.begin();
+       it != children.end(); ++it) {
+    write_model(out, it->second);
+  }
+
+  // connections as (source model, source port, destination model,
+  // destination port), an empty model name stands for the coupled model
+  std::vector < std::string > cnx;
+  const graph::ConnectionList& inputs = coupled->getInternalInputPortList();
+  const graph::ConnectionList& outputs = coupled->getInternalOutputPortList();
+
+  for (graph::ConnectionList::const_iterator it = inputs.begin();
+       it != inputs.end(); ++it) {
+    for (graph::ModelPortList::const_iterator jt = it->second.begin();
+	 jt != it->second.end(); ++jt) {
+      cnx.push_back(std::string());
+      cnx.push_back(it->first);
+      cnx.push_back(jt->first->getName());
+      cnx.push_back(jt->second);
+    }
+  }
+  for (graph::ConnectionList::const_iterator it = outputs.begin();
+       it != outputs.end(); ++it) {
+    for (graph::ModelPortList::const_iterator jt = it->second.begin();
+	 jt != it->second.end(); ++jt) {
+      cnx.push_back(jt->first->getName());
+      cnx.push_back(jt->second);
+      cnx.push_back(std::string());
+      cnx.push_back(it->first);
+    }
+  }
+  for (graph::ModelList::const_iterator it = children.begin();
+       it != children.end(); ++it) {
+    const graph::ConnectionList& ports = it->second->getOutputPortList();
+
+    for (graph::ConnectionList::const_iterator jt = ports.begin();
+	 jt != ports.end(); ++jt) {
+      for (graph::ModelPortList::const_iterator kt = jt->second.begin();
+	   kt != jt->second.end(); ++kt) {
+	if (kt->first != coupled) {
+	  cnx.push_back(it->first);
+	  cnx.push_back(jt->first);
+	  cnx.push_back(kt->first->getName());
+	  cnx.push_back(kt->second);
+	}
+      }
+    }
+  }
+  write_strings(out, cnx);
+}
+
+void read_ports(binary_reader& in, graph::Model* model, bool input)
+{
+  uint32_t count = in.u32();
+
+  for (uint32_t i = 0; i < count; ++i) {
+    if (input) {
+      model->addInputPort(in.str());
+    } else {
+      model->addOutputPort(in.str());
+    }
+  }
+}
+
+// the model is created by its parent (or as the root when parent is 0)
+graph::Model* read_model(binary_reader& in, graph::CoupledModel* parent)
+{
+  uint8_t kind = in.u8();
+
+  if (kind == MODEL_NONE) {
+    return 0;
+  }
+  if (kind != MODEL_ATOMIC and kind != MODEL_COUPLED) {
+    throw std::runtime_error("snapshot: bad model kind");
+  }
+
+  std::string name = in.str();
+  graph::Model* model;
+
+  if (kind == MODEL_ATOMIC) {
+    model = parent ? parent->addAtomicModel(name) :
+      new graph::AtomicModel(name, 0);
+  } else {
+    model = parent ? parent->addCoupledModel(name) :
+      new graph::CoupledModel(name, 0);
+  }
+
+  int x = in.u32(), y = in.u32(), width = in.u32(), height = in.u32();
+
+  model->setPosition(x, y);
+  model->setSize(width, height);
+  read_ports(in, model, true);
+  read_ports(in, model, false);
+
+  if (kind == MODEL_ATOMIC) {
+    graph::AtomicModel* atom = static_cast < graph::AtomicModel* >(model);
+
+    atom->setConditions(read_strings(in));
+    atom->setDynamics(in.str());
+    atom->setObservables(in.str());
+    return model;
+  }
+
+  graph::CoupledModel* coupled = static_cast < graph::CoupledModel* >(model);
+  uint32_t count = in.u32();
+
+  for (uint32_t i = 0; i < count; ++i) {
+    read_model(in, coupled);
+  }
+
+  std::vector < std::string > cnx = read_strings(in);
+
+  if (cnx.size() % 4 != 0) {
+    throw std::runtime_error("snapshot: bad connection list");
+  }
+  for (unsigned int i = 0; i < cnx.size(); i += 4) {
+    if (cnx[i].empty()) {
+      coupled->addInputConnection(cnx[i + 1], cnx[i + 2], cnx[i + 3]);
+    } else if (cnx[i + 2].empty()) {
+      coupled->addOutputConnection(cnx[i], cnx[i + 1], cnx[i + 3]);
+    } else {
+      coupled->addInternalConnection(cnx[i], cnx[i + 1], cnx[i + 2],
+				     cnx[i + 3]);
+    }
+  }
+  return model;
+}
+
+}
+
+uint8_t binary_reader::u8()
+{
+  uint8_t x;
+
+  raw(&x, sizeof(x));
+  return x;
+}
+
+uint32_t binary_reader::u32()
+{
+  uint32_t x;
+
+  raw(&x, sizeof(x));
+  return x;
+}
+
+uint64_t binary_reader::u64()
+{
+  uint64_t x;
+
+  raw(&x, sizeof(x));
+  return x;
+}
+
+double binary_reader::f64()
+{
+  double x;
+
+  raw(&x, sizeof(x));
+  return x;
+}
+
+std::string binary_reader::str()
+{
+  uint32_t size = u32();
+
+  if (static_cast < size_t >(_end - _data) < size) {
+    throw std::runtime_error("snapshot: truncated buffer");
+  }
+
+  std::string x(_data, size);
+
+  _data += size;
+  return x;
+}
+
+void binary_reader::raw(void* data, size_t size)
+{
+  if (static_cast < size_t >(_end - _data) < size) {
+    throw std::runtime_error("snapshot: truncated buffer");
+  }
+  std::memcpy(data, _data, size);
+  _data += size;
+}
+
+uint64_t checksum(const char* data, size_t size)
+{
+  uint64_t hash = 14695981039346656037ULL;
+
+  for (size_t i = 0; i < size; ++i) {
+    hash ^= static_cast < unsigned char >(data[i]);
+    hash *= 1099511628211ULL;
+  }
+  return hash;
+}
+
+void write_value(binary_writer& out, const value::Value* value)
+{
+  if (not value) {
+    out.u8(value::Value::NIL);
+    return;
+  }
+
+  out.u8(value->getType());
+  switch (value->getType()) {
+  case value::Value::BOOLEAN:
+    out.u8(value::toBoolean(*value));
+    break;
+  case value::Value::INTEGER:
+    out.u64(static_cast < int64_t >(value::toInteger(*value)));
+    break;
+  case value::Value::DOUBLE:
+    out.f64(value::toDouble(*value));
+    break;
+  case value::Value::STRING:
+    out.str(value::toString(*value));
+    break;
+  case value::Value::XMLTYPE:
+    out.str(value::toXml(*value));
+    break;
+  case value::Value::SET: {
+    const value::Set& set = value->toSet();
+
+    out.u32(set.size());
+    for (value::Set::const_iterator it = set.begin(); it != set.end(); ++it) {
+      write_value(out, *it);
+    }
+    break;
+  }
+  case value::Value::MAP: {
+    const value::Map& map = value->toMap();
+
+    out.u32(map.size());
+    for (value::Map::const_iterator it = map.begin(); it != map.end(); ++it) {
+      out.str(it->first);
+      write_value(out, it->second);
+    }
+    break;
+  }
+  case value::Value::TUPLE: {
+    const std::vector < double >& tuple = value->toTuple().value();
+
+    out.u32(tuple.size());
+    out.raw(tuple.data(), tuple.size() * sizeof(double));
+    break;
+  }
+  case value::Value::TABLE: {
+    const value::Table& table = value->toTable();
+
+    out.u32(table.width());
+    out.u32(table.height());
+    out.raw(table.value().data(),
+	    table.width() * table.height() * sizeof(double));
+    break;
+  }
+  case value::Value::MATRIX: {
+    const value::Matrix& matrix = value->toMatrix();
+
+    out.u32(matrix.columns());
+    out.u32(matrix.rows());
+    for (unsigned int r = 0; r < matrix.rows(); ++r) {
+      for (unsigned int c = 0; c < matrix.columns(); ++c) {
+	write_value(out, matrix.get(c, r));
+      }
+    }
+    break;
+  }
+  case value::Value::NIL:
+    break;
+  default:
+    throw std::runtime_error("snapshot: user values cannot be serialized");
+  }
+}
+
+value::Value* read_value(binary_reader& in)
+{
+  uint8_t type = in.u8();
+
+  switch (type) {
+  case value::Value::BOOLEAN:
+    return value::Boolean::create(in.u8() != 0);
+  case value::Value::INTEGER:
+    return value::Integer::create(static_cast < int64_t >(in.u64()));
+  case value::Value::DOUBLE:
+    return value::Double::create(in.f64());
+  case value::Value::STRING:
+    return value::String::create(in.str());
+  case value::Value::XMLTYPE:
+    return value::Xml::create(in.str());
+  case value::Value::SET: {
+    std::unique_ptr < value::Set > set(value::Set::create());
+    uint32_t size = in.u32();
+
+    for (uint32_t i = 0; i < size; ++i) {
+      set->add(read_value(in));
+    }
+    return set.release();
+  }
+  case value::Value::MAP: {
+    std::unique_ptr < value::Map > map(value::Map::create());
+    uint32_t size = in.u32();
+
+    for (uint32_t i = 0; i < size; ++i) {
+      std::string name = in.str();
+
+      map->add(name, read_value(in));
+    }
+    return map.release();
+  }
+  case value::Value::TUPLE: {
+    std::unique_ptr < value::Tuple > tuple(new value::Tuple(in.u32()));
+
+    in.raw(tuple->value().data(), tuple->value().size() * sizeof(double));
+    return tuple.release();
+  }
+  case value::Value::TABLE: {
+    uint32_t width = in.u32();
+    uint32_t height = in.u32();
+    std::unique_ptr < value::Table > table(new value::Table(width, height));
+
+    in.raw(table->value().data(), width * height * sizeof(double));
+    return table.release();
+  }
+  case value::Value::MATRIX: {
+    uint32_t columns = in.u32();
+    uint32_t rows = in.u32();
+    std::unique_ptr < value::Matrix > matrix(
+      new value::Matrix(columns, rows, columns, rows));
+
+    for (uint32_t r = 0; r < rows; ++r) {
+      for (uint32_t c = 0; c < columns; ++c) {
+	matrix->add(c, r, read_value(in));
+      }
+    }
+    return matrix.release();
+  }
+  case value::Value::NIL:
+    return value::Null::create();
+  default:
+    throw std::runtime_error("snapshot: bad value type");
+  }
+}
+
+void write_vpz(binary_writer& out, const vpz::Vpz& vpz)
+{
+  const vpz::Project& project = vpz.project();
+  const vpz::Experiment& exp = project.experiment();
+
+  out.str(project.author());
+  out.str(project.date());
+  out.str(project.version());
+
+  out.str(exp.name());
+  out.f64(exp.begin());
+  out.f64(exp.duration());
+  out.u32(exp.seed());
+
+  const vpz::ConditionList& conditions = exp.conditions().conditionlist();
+
+  out.u32(conditions.size());
+  for (vpz::ConditionList::const_iterator it = conditions.begin();
+       it != conditions.end(); ++it) {
+    const vpz::Condition::ConditionValues& ports =
+      it->second.conditionvalues();
+
+    out.str(it->first);
+    out.u32(ports.size());
+    for (vpz::Condition::ConditionValues::const_iterator jt = ports.begin();
+	 jt != ports.end(); ++jt) {
+      out.str(jt->first);
+      write_value(out, jt->second);
+    }
+  }
+
+  const vpz::OutputList& outputs = exp.views().outputs().outputlist();
+
+  out.u32(outputs.size());
+  for (vpz::OutputList::const_iterator it = outputs.begin();
+       it != outputs.end(); ++it) {
+    out.str(it->first);
+    out.u8(it->second.format());
+    out.str(it->second.location());
+    out.str(it->second.plugin());
+    out.str(it->second.package());
+    write_value(out, it->second.data());
+  }
+
+  const vpz::ViewList& views = exp.views().viewlist();
+
+  out.u32(views.size());
+  for (vpz::ViewList::const_iterator it = views.begin(); it != views.end();
+       ++it) {
+    out.str(it->first);
+    out.u8(it->second.type());
+    out.f64(it->second.timestep());
+    out.str(it->second.output());
+    out.str(it->second.data());
+  }
+
+  const vpz::ObservableList& observables =
+    exp.views().observables().observablelist();
+
+  out.u32(observables.size());
+  for (vpz::ObservableList::const_iterator it = observables.begin();
+       it != observables.end(); ++it) {
+    const vpz::ObservablePortList& ports = it->second.observableportlist();
+
+    out.str(it->first);
+    out.u32(ports.size());
+    for (vpz::ObservablePortList::const_iterator jt = ports.begin();
+	 jt != ports.end(); ++jt) {
+      out.str(jt->first);
+      write_strings(out, jt->second.viewnamelist());
+    }
+  }
+
+  const vpz::DynamicList& dynamics = project.dynamics().dynamiclist();
+
+  out.u32(dynamics.size());
+  for (vpz::DynamicList::const_iterator it = dynamics.begin();
+       it != dynamics.end(); ++it) {
+    out.str(it->first);
+    out.str(it->second.package());
+    out.str(it->second.library());
+    out.str(it->second.language());
+  }
+
+  write_model(out, project.model().model());
+}
+
+vpz::Vpz* read_vpz(binary_reader& in)
+{
+  std::unique_ptr < vpz::Vpz > vpz(new vpz::Vpz());
+  vpz::Project& project = vpz->project();
+  vpz::Experiment& exp = project.experiment();
+
+  project.setAuthor(in.str());
+  project.setDate(in.str());
+  project.setVersion(in.str());
+
+  exp.setName(in.str());
+  exp.setBegin(in.f64());
+  exp.setDuration(in.f64());
+  exp.setSeed(in.u32());
+
+  uint32_t count = in.u32();
+
+  for (uint32_t i = 0; i < count; ++i) {
+    vpz::Condition& cnd = exp.conditions().add(vpz::Condition(in.str()));
+    uint32_t ports = in.u32();
+
+    for (uint32_t j = 0; j < ports; ++j) {
+      std::string port = in.str();
+      std::unique_ptr < value::Value > values(read_value(in));
+
+      if (not values->isSet()) {
+	throw std::runtime_error("snapshot: bad condition port " + port);
+      }
+      cnd.add(port);
+
+      const value::Set& set = values->toSet();
+
+      // copies: the decoded set keeps ownership of its elements
+      for (value::Set::const_iterator it = set.begin(); it != set.end();
+	   ++it) {
+	cnd.addValueToPort(port, **it);
+      }
+    }
+  }
+
+  count = in.u32();
+  for (uint32_t i = 0; i < count; ++i) {
+    std::string name = in.str();
+    uint8_t format = in.u8();
+    std::string location = in.str();
+    std::string plugin = in.str();
+    std::string package = in.str();
+    std::unique_ptr < value::Value > data(read_value(in));
+    vpz::Output& output = format == vpz::Output::LOCAL ?
+      exp.views().outputs().addLocalStream(name, location, plugin, package) :
+      exp.views().outputs().addDistantStream(name, location, plugin, package);
+
+    if (data->getType() != value::Value::NIL) {
+      output.setData(data.release());
+    }
+  }
+
+  count = in.u32();
+  for (uint32_t i = 0; i < count; ++i) {
+    std::string name = in.str();
+    uint8_t type = in.u8();
+    double timestep = in.f64();
+    std::string output = in.str();
+    std::string data = in.str();
+    vpz::View* view;
+
+    switch (type) {
+    case vpz::View::TIMED:
+      view = &exp.views().addTimedView(name, timestep, output);
+      break;
+    case vpz::View::EVENT:
+      view = &exp.views().addEventView(name, output);
+      break;
+    case vpz::View::FINISH:
+      view = &exp.views().addFinishView(name, output);
+      break;
+    default:
+      throw std::runtime_error("snapshot: bad view type");
+    }
+    view->setData(data);
+  }
+
+  count = in.u32();
+  for (uint32_t i = 0; i < count; ++i) {
+    vpz::Observable obs(in.str());
+    uint32_t ports = in.u32();
+
+    for (uint32_t j = 0; j < ports; ++j) {
+      vpz::ObservablePort& port = obs.add(in.str());
+      std::vector < std::string > names = read_strings(in);
+
+      for (unsigned int k = 0; k < names.size(); ++k) {
+	port.add(names[k]);
+      }
+    }
+    exp.views().observables().add(obs);
+  }
+
+  count = in.u32();
+  for (uint32_t i = 0; i < count; ++i) {
+    vpz::Dynamic dyn(in.str());
+
+    dyn.setPackage(in.str());
+    dyn.setLibrary(in.str());
+    dyn.setLanguage(in.str());
+    project.dynamics().add(dyn);
+  }
+
+  project.model().setModel(read_model(in, 0));
+  if (not in.eof()) {
+    throw std::runtime_error("snapshot: trailing data");
+  }
+  return vpz.release();
+}
+
+void save_snapshot(const std::string& path, const vpz::Vpz& vpz)
+{
+  binary_writer payload;
+  binary_writer header;
+
+  write_vpz(payload, vpz);
+  header.raw(magic, sizeof(magic));
+  header.u32(version);
+  header.u64(payload.buffer().size());
+  header.u64(checksum(payload.buffer().data(), payload.buffer().size()));
+
+  std::string tmp = path + ".tmp";
+  std::ofstream file(tmp.c_str(), std::ios::binary | std::ios::trunc);
+
+  file.write(header.buffer().data(), header.buffer().size());
+  file.write(payload.buffer().data(), payload.buffer().size());
+  file.close();
+  if (not file or std::rename(tmp.c_str(), path.c_str()) != 0) {
+    std::remove(tmp.c_str());
+    throw std::runtime_error("snapshot: cannot write " + path);
+  }
+}
+
+vpz::Vpz* load_snapshot(const std::string& path)
+{
+  std::ifstream file(path.c_str(), std::ios::binary);
+
+  if (not file) {
+    throw std::runtime_error("snapshot: cannot open " + path);
+  }
+
+  std::string buffer((std::istreambuf_iterator < char >(file)),
+		     std::istreambuf_iterator < char >());
+  binary_reader header(buffer.data(), buffer.size());
+  char tag[sizeof(magic)];
+
+  header.raw(tag, sizeof(tag));
+  if (std::memcmp(tag, magic, sizeof(magic)) != 0) {
+    throw std::runtime_error("snapshot: " + path + " is not a snapshot");
+  }
+  if (header.u32() != version) {
+    throw std::runtime_error("snapshot: unsupported version in " + path);
+  }
+
+  uint64_t size = header.u64();
+  uint64_t sum = header.u64();
+  size_t offset = sizeof(magic) + sizeof(uint32_t) + 2 * sizeof(uint64_t);
+
+  if (buffer.size() - offset != size or
+      checksum(buffer.data() + offset, size) != sum) {
+    throw std::runtime_error("snapshot: " + path + " is corrupted");
+  }
+
+  binary_reader payload(buffer.data() + offset, size);
+
+  return read_vpz(payload);
+}
+
+void capture_state(const vpz::Vpz& vpz, experiment_state& state)
+{
+  const vpz::Experiment& exp = vpz.project().experiment();
+  const vpz::ConditionList& conditions = exp.conditions().conditionlist();
+  const vpz::OutputList& outputs = exp.views().outputs().outputlist();
+
+  state.begin = exp.begin();
+  state.duration = exp.duration();
+  state.seed = exp.seed();
+  state.conditions.clear();
+  state.outputs.clear();
+
+  for (vpz::ConditionList::const_iterator it = conditions.begin();
+       it != conditions.end(); ++it) {
+    const vpz::Condition::ConditionValues& ports =
+      it->second.conditionvalues();
+    experiment_state::port_list& lst = state.conditions[it->first];
+
+    for (vpz::Condition::ConditionValues::const_iterator jt = ports.begin();
+	 jt != ports.end(); ++jt) {
+      binary_writer out;
+
+      write_value(out, jt->second);
+      lst[jt->first] = out.buffer();
+    }
+  }
+
+  for (vpz::OutputList::const_iterator it = outputs.begin();
+       it != outputs.end(); ++it) {
+    experiment_state::output& o = state.outputs[it->first];
+    binary_writer out;
+
+    write_value(out, it->second.data());
+    o.format = it->second.format();
+    o.location = it->second.location();
+    o.plugin = it->second.plugin();
+    o.package = it->second.package();
+    o.data = out.buffer();
+  }
+}
+
+void restore_port(vpz::Vpz& vpz, const experiment_state& state,
+		  const std::string& condition, const std::string& port)
+{
+  vpz::Conditions& conditions = vpz.project().experiment().conditions();
+  experiment_state::condition_list::const_iterator it =
+    state.conditions.find(condition);
+
+  if (it == state.conditions.end()) {
+    return;
+  }
+  if (not conditions.exist(condition)) {
+    conditions.add(vpz::Condition(condition));
+  }
+
+  vpz::Condition& cnd = conditions.get(condition);
+  experiment_state::port_list::const_iterator jt = it->second.find(port);
+
+  if (jt == it->second.end()) {
+    if (cnd.conditionvalues().count(port)) {
+      cnd.del(port);
+    }
+    return;
+  }
+
+  binary_reader in(jt->second.data(), jt->second.size());
+  std::unique_ptr < value::Value > values(read_value(in));
+
+  if (cnd.conditionvalues().count(port)) {
+    cnd.clearValueOfPort(port);
+  } else {
+    cnd.add(port);
+  }
+  if (values->isSet()) {
+    const value::Set& set = values->toSet();
+
+    // copies: the decoded set keeps ownership of its elements
+    for (value::Set::const_iterator it = set.begin(); it != set.end(); ++it) {
+      cnd.addValueToPort(port, **it);
+    }
+  }
+}
+
+void restore_conditions(vpz::Vpz& vpz, const experiment_state& state)
+{
+  vpz::Conditions& conditions = vpz.project().experiment().conditions();
+  std::list < std::string > names;
+
+  conditions.conditionnames(names);
+  for (std::list < std::string >::const_iterator it = names.begin();
+       it != names.end(); ++it) {
+    if (not state.conditions.count(*it)) {
+      conditions.del(*it);
+    } else {
+      std::list < std::string > ports;
+
+      conditions.get(*it).portnames(ports);
+      for (std::list < std::string >::const_iterator jt = ports.begin();
+	   jt != ports.end(); ++jt) {
+	if (not state.conditions.find(*it)->second.count(*jt)) {
+	  conditions.get(*it).del(*jt);
+	}
+      }
+    }
+  }
+
+  for (experiment_state::condition_list::const_iterator it =
+	 state.conditions.begin(); it != state.conditions.end(); ++it) {
+    if (not conditions.exist(it->first)) {
+      conditions.add(vpz::Condition(it->first));
+    }
+    for (experiment_state::port_list::const_iterator jt = it->second.begin();
+	 jt != it->second.end(); ++jt) {
+      restore_port(vpz, state, it->first, jt->first);
+    }
+  }
+}
+
+void restore_outputs(vpz::Vpz& vpz, const experiment_state& state)
+{
+  vpz::Outputs& outputs = vpz.project().experiment().views().outputs();
+
+  for (experiment_state::output_list::const_iterator it =
+	 state.outputs.begin(); it != state.outputs.end(); ++it) {
+    const experiment_state::output& o = it->second;
+    binary_reader in(o.data.data(), o.data.size());
+    std::unique_ptr < value::Value > data(read_value(in));
+
+    if (not outputs.exist(it->first)) {
+      continue;
+    }
+
+    vpz::Output& output = outputs.get(it->first);
+
+    if (o.format == vpz::Output::LOCAL) {
+      output.setLocalStream(o.location, o.plugin, o.package);
+    } else {
+      output.setDistantStream(o.location, o.plugin, o.package);
+    }
+    output.setData(data->getType() == value::Value::NIL ? 0 :
+		   data.release());
+  }
+}
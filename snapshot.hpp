@@ -0,0 +1,135 @@
+#ifndef NODE_VLE_SNAPSHOT_HPP
+#define NODE_VLE_SNAPSHOT_HPP
+
+#include <vle/value/Value.hpp>
+#include <vle/vpz/Vpz.hpp>
+
+#include <map>
+#include <stdint.h>
+#include <string>
+
+/*
+ * Compact binary serialization of values and of a parsed experiment.
+ *
+ * A snapshot file is a header followed by the payload:
+ *
+ *   char     magic[8]     "VLEVPZS"
+ *   uint32   version
+ *   uint64   payload size
+ *   uint64   payload checksum (FNV-1a)
+ *
+ * The payload holds the project, the experiment (begin, duration, seed,
+ * conditions, outputs, views, observables), the dynamics and the model
+ * hierarchy with its ports and connections. Loading it rebuilds a
+ * vpz::Vpz without going through the XML parser.
+ */
+
+class binary_writer
+{
+public:
+  void u8(uint8_t x)
+  { _buffer.push_back(static_cast < char >(x)); }
+
+  void u32(uint32_t x)
+  { _buffer.append(reinterpret_cast < const char* >(&x), sizeof(x)); }
+
+  void u64(uint64_t x)
+  { _buffer.append(reinterpret_cast < const char* >(&x), sizeof(x)); }
+
+  void f64(double x)
+  { _buffer.append(reinterpret_cast < const char* >(&x), sizeof(x)); }
+
+  void str(const std::string& x)
+  { u32(x.size()); _buffer.append(x); }
+
+  void raw(const void* data, size_t size)
+  { _buffer.append(static_cast < const char* >(data), size); }
+
+  const std::string& buffer() const
+  { return _buffer; }
+
+private:
+  std::string _buffer;
+};
+
+// every read is bounds checked, a truncated or corrupted buffer raises
+// std::runtime_error
+class binary_reader
+{
+public:
+  binary_reader(const char* data, size_t size)
+    : _data(data), _end(data + size)
+  { }
+
+  uint8_t u8();
+  uint32_t u32();
+  uint64_t u64();
+  double f64();
+  std::string str();
+  void raw(void* data, size_t size);
+
+  bool eof() const
+  { return _data == _end; }
+
+private:
+  const char* _data;
+  const char* _end;
+};
+
+uint64_t checksum(const char* data, size_t size);
+
+// null pointers are encoded as value::Value::NIL
+void write_value(binary_writer& out, const vle::value::Value* value);
+
+vle::value::Value* read_value(binary_reader& in);
+
+void write_vpz(binary_writer& out, const vle::vpz::Vpz& vpz);
+
+vle::vpz::Vpz* read_vpz(binary_reader& in);
+
+void save_snapshot(const std::string& path, const vle::vpz::Vpz& vpz);
+
+vle::vpz::Vpz* load_snapshot(const std::string& path);
+
+/*
+ * In memory baseline of the mutable part of an experiment: begin,
+ * duration, seed, condition ports and output plugins. Port values are
+ * kept in their binary encoding and decoded only when a port is put
+ * back.
+ */
+
+struct experiment_state
+{
+  struct output
+  {
+    uint8_t format;
+    std::string location;
+    std::string plugin;
+    std::string package;
+    std::string data;
+  };
+
+  typedef std::map < std::string, std::string > port_list;
+  typedef std::map < std::string, port_list > condition_list;
+  typedef std::map < std::string, output > output_list;
+
+  double begin;
+  double duration;
+  uint32_t seed;
+  condition_list conditions;
+  output_list outputs;
+};
+
+void capture_state(const vle::vpz::Vpz& vpz, experiment_state& state);
+
+// put back one port, the port is removed if it does not exist in the
+// state
+void restore_port(vle::vpz::Vpz& vpz, const experiment_state& state,
+		  const std::string& condition, const std::string& port);
+
+// remove the conditions missing from the state, put back every port
+void restore_conditions(vle::vpz::Vpz& vpz, const experiment_state& state);
+
+void restore_outputs(vle::vpz::Vpz& vpz, const experiment_state& state);
+
+#endif
@@ -0,0 +1,50 @@
+// Runs each test of a file in a child process, so that a deadlock fails
+// on a timeout instead of hanging the suite. The tests need a VLE
+// package with an experiment that has a real condition port and an
+// observed column:
+//
+//   VLE_TEST_PACKAGE=pkg VLE_TEST_VPZ=exp.vpz VLE_TEST_CONDITION=cond \
+//   VLE_TEST_PORT=a VLE_TEST_COLUMN=view.Top.Model.port npm test
+
+var child_process = require('child_process');
+var path = require('path');
+
+var env = process.env;
+
+function configured() {
+  return !!(env.VLE_TEST_PACKAGE && env.VLE_TEST_VPZ &&
+            env.VLE_TEST_CONDITION && env.VLE_TEST_PORT &&
+            env.VLE_TEST_COLUMN);
+}
+
+// tests: name -> function (vle, done)
+exports.run = function (filename, tests) {
+  var suite = path.basename(filename, '.js');
+  var failed = 0;
+
+  if (process.argv[2]) {
+    tests[process.argv[2]](require('..'), function () {
+      process.exit(0);
+    });
+    return;
+  }
+  if (!configured()) {
+    console.log(suite + ': VLE_TEST_* not set, skipped');
+    return;
+  }
+  Object.keys(tests).forEach(function (name) {
+    var res = child_process.spawnSync(process.execPath, [filename, name],
+                                      {stdio: 'inherit', timeout: 120000});
+
+    if (res.status !== 0) {
+      console.log(suite + ': ' + name + ' failed' +
+                  (res.signal ? ' (' + res.signal + ')' : ''));
+      ++failed;
+    } else {
+      console.log(suite + ': ' + name + ' ok');
+    }
+  });
+  if (failed) {
+    process.exit(1);
+  }
+};
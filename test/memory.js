@@ -0,0 +1,52 @@
+// Memory budget tests, see common.js for the configuration.
+
+var assert = require('assert');
+var common = require('./common');
+
+var env = process.env;
+
+common.run(__filename, {
+  // Jobs queued over the budget while calibrate holds its reservation
+  // must not keep the pool threads calibrate waits for.
+  queued_jobs_during_calibrate: function (vle, done) {
+    var vpz = new vle.Vle(env.VLE_TEST_PACKAGE, env.VLE_TEST_VPZ);
+    var threads = vle.scheduler_stats().threads;
+    var observed = {};
+    var callbacks = 0;
+    var submitted = false;
+
+    observed[env.VLE_TEST_COLUMN] = new Float64Array([0, 0, 0]);
+    vle.set_memory_budget(1, 'queue');
+
+    var best = vpz.calibrate({
+      params: [{condition: env.VLE_TEST_CONDITION, port: env.VLE_TEST_PORT,
+                min: 0, max: 1}],
+      observed: observed,
+      times: [0, 1, 2].map(function (i) { return vpz.get_begin() + i; }),
+      threads: threads,
+      max_iterations: 3,
+      progress: function () {
+        var i;
+
+        if (submitted) {
+          return;
+        }
+        submitted = true;
+        for (i = 0; i < threads; ++i) {
+          vpz.submit({}, function (err) {
+            if (err) {
+              assert.ok(/memory budget exceeded/.test(err.message),
+                        err.message);
+            }
+            if (++callbacks === threads) {
+              done();
+            }
+          });
+        }
+      }
+    });
+
+    assert.ok(best);
+    assert.ok(submitted);
+  }
+});
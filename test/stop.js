@@ -0,0 +1,27 @@
+// Early termination tests, see common.js for the configuration.
+
+var assert = require('assert');
+var common = require('./common');
+
+var env = process.env;
+
+common.run(__filename, {
+  // A predicate on the time column of the observed view stops the run
+  // about half way.
+  predicate_stops_run: function (vle, done) {
+    var vpz = new vle.Vle(env.VLE_TEST_PACKAGE, env.VLE_TEST_VPZ);
+    var view = env.VLE_TEST_COLUMN.split('.')[0];
+    var begin = vpz.get_begin();
+    var duration = vpz.get_duration();
+    var res = vpz.run({
+      stop: [{column: view + '.time', op: '>=', value: begin + duration / 2}],
+      check_interval: duration / 100
+    });
+
+    assert.ok(res.stopped);
+    assert.strictEqual(res.stop_reason.indexOf(view + '.time >= '), 0);
+    assert.ok(res.stop_time >= begin + duration / 2);
+    assert.ok(res.stop_time < begin + duration);
+    done();
+  }
+});
@@ -0,0 +1,257 @@
+#include "trace.hpp"
+
+#include <chrono>
+#include <functional>
+#include <iomanip>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include <unistd.h>
+#ifdef __linux__
+#include <sys/syscall.h>
+#endif
+
+std::atomic < bool > trace_enabled(false);
+
+namespace {
+
+struct trace_event
+{
+  const char* name;
+  uint64_t run;
+  int64_t begin;
+  int64_t end;
+};
+
+// one slot of a ring: seq is n + 1 once event n is complete, 0 while it
+// is written. A dump running next to the owner keeps an event only when
+// seq is the expected one before and after the copy; the fields are
+// atomics so that the copy is not a data race.
+struct trace_slot
+{
+  trace_slot() : seq(0), name(0), run(0), begin(0), end(0)
+  { }
+
+  std::atomic < uint64_t > seq;
+  std::atomic < const char* > name;
+  std::atomic < uint64_t > run;
+  std::atomic < int64_t > begin;
+  std::atomic < int64_t > end;
+};
+
+// written by its thread only
+struct trace_buffer
+{
+  trace_buffer() : tid(0), size(0), count(0), generation(0)
+  { }
+
+  uint64_t tid;
+  std::string name;
+  std::unique_ptr < trace_slot[] > events;
+  uint64_t size;
+  std::atomic < uint64_t > count;
+  uint64_t generation;
+};
+
+std::mutex registry_mutex;
+std::vector < trace_buffer* > registry;
+std::atomic < uint64_t > generation(0);
+std::atomic < uint64_t > next_run(0);
+unsigned int capacity = 16384;
+
+thread_local trace_buffer* local_buffer = 0;
+thread_local uint64_t local_run = 0;
+
+uint64_t thread_id()
+{
+#ifdef __linux__
+  return syscall(SYS_gettid);
+#else
+  return std::hash < std::thread::id >()(std::this_thread::get_id());
+#endif
+}
+
+// buffers are never freed: a thread that ends leaves its events for the
+// next dump
+trace_buffer* buffer()
+{
+  if (not local_buffer) {
+    std::lock_guard < std::mutex > lock(registry_mutex);
+
+    local_buffer = new trace_buffer();
+    local_buffer->tid = thread_id();
+    registry.push_back(local_buffer);
+  }
+
+  uint64_t current = generation.load(std::memory_order_acquire);
+
+  if (local_buffer->generation != current) {
+    // restarted since the last event of this thread
+    std::lock_guard < std::mutex > lock(registry_mutex);
+
+    local_buffer->events.reset(new trace_slot[capacity]);
+    local_buffer->size = capacity;
+    local_buffer->count.store(0, std::memory_order_relaxed);
+    local_buffer->generation = current;
+  }
+  return local_buffer;
+}
+
+void write_string(std::ostream& out, const std::string& str)
+{
+  out << '"';
+  for (unsigned int i = 0; i < str.size(); ++i) {
+    if (str[i] == '"' or str[i] == '\\') {
+      out << '\\';
+    }
+    out << str[i];
+  }
+  out << '"';
+}
+
+}
+
+int64_t trace_now()
+{
+  return std::chrono::duration_cast < std::chrono::nanoseconds >(
+    std::chrono::steady_clock::now().time_since_epoch()).count();
+}
+
+uint64_t trace_next_id()
+{
+  return tracing() ? ++next_run : 0;
+}
+
+void trace_record(const char* name, uint64_t run, int64_t begin,
+		  int64_t end)
+{
+  trace_buffer* b = buffer();
+  uint64_t n = b->count.load(std::memory_order_relaxed);
+  trace_slot& e = b->events[n % b->size];
+
+  e.seq.store(0, std::memory_order_relaxed);
+  std::atomic_thread_fence(std::memory_order_release);
+  e.name.store(name, std::memory_order_relaxed);
+  e.run.store(run, std::memory_order_relaxed);
+  e.begin.store(begin, std::memory_order_relaxed);
+  e.end.store(end, std::memory_order_relaxed);
+  e.seq.store(n + 1, std::memory_order_release);
+  b->count.store(n + 1, std::memory_order_release);
+}
+
+namespace {
+
+// false when the slot no longer holds event n
+bool read_event(const trace_slot& slot, uint64_t n, trace_event& e)
+{
+  if (slot.seq.load(std::memory_order_acquire) != n + 1) {
+    return false;
+  }
+  e.name = slot.name.load(std::memory_order_relaxed);
+  e.run = slot.run.load(std::memory_order_relaxed);
+  e.begin = slot.begin.load(std::memory_order_relaxed);
+  e.end = slot.end.load(std::memory_order_relaxed);
+  std::atomic_thread_fence(std::memory_order_acquire);
+  return slot.seq.load(std::memory_order_relaxed) == n + 1;
+}
+
+}
+
+void trace_thread_name(const char* name)
+{
+  if (tracing()) {
+    trace_buffer* b = buffer();
+    std::lock_guard < std::mutex > lock(registry_mutex);
+
+    b->name = name;
+  }
+}
+
+void trace_start(unsigned int events)
+{
+  {
+    std::lock_guard < std::mutex > lock(registry_mutex);
+
+    capacity = events > 0 ? events : 1;
+  }
+  // buffers are cleared lazily by their own thread
+  ++generation;
+  trace_enabled = true;
+}
+
+void trace_stop()
+{
+  trace_enabled = false;
+}
+
+uint64_t trace_dump(std::ostream& out)
+{
+  std::lock_guard < std::mutex > lock(registry_mutex);
+  uint64_t current = generation.load(std::memory_order_acquire);
+  uint64_t written = 0;
+  long pid = getpid();
+  std::ios_base::fmtflags flags = out.flags();
+  std::streamsize precision = out.precision();
+
+  // timestamps in us, to the ns
+  out << std::fixed << std::setprecision(3) << "{\"traceEvents\":[";
+  for (unsigned int i = 0; i < registry.size(); ++i) {
+    trace_buffer* b = registry[i];
+
+    if (b->generation != current) {
+      continue;
+    }
+
+    uint64_t count = b->count.load(std::memory_order_acquire);
+    uint64_t first = count > b->size ? count - b->size : 0;
+
+    if (not b->name.empty()) {
+      out << (written ? "," : "") << "\n{\"name\":\"thread_name\","
+	  << "\"ph\":\"M\",\"pid\":" << pid << ",\"tid\":" << b->tid
+	  << ",\"args\":{\"name\":";
+      write_string(out, b->name);
+      out << "}}";
+      ++written;
+    }
+    // the owner may record meanwhile, overwritten events are skipped
+    for (uint64_t k = first; k < count; ++k) {
+      trace_event e;
+
+      if (not read_event(b->events[k % b->size], k, e)) {
+	continue;
+      }
+      out << (written ? "," : "") << "\n{\"name\":\"" << e.name
+	  << "\",\"cat\":\"vle\",\"ph\":\"X\",\"ts\":" << e.begin / 1000.0
+	  << ",\"dur\":" << (e.end - e.begin) / 1000.0
+	  << ",\"pid\":" << pid << ",\"tid\":" << b->tid;
+      if (e.run) {
+	out << ",\"args\":{\"run\":" << e.run << "}";
+      }
+      out << "}";
+      ++written;
+    }
+  }
+  out << "\n],\"displayTimeUnit\":\"ms\"}\n";
+  out.flags(flags);
+  out.precision(precision);
+  return written;
+}
+
+trace_run::trace_run(uint64_t id)
+  : _previous(local_run)
+{
+  local_run = id;
+}
+
+trace_run::~trace_run()
+{
+  local_run = _previous;
+}
+
+uint64_t trace_run::current()
+{
+  return local_run;
+}
@@ -0,0 +1,90 @@
+#ifndef NODE_VLE_TRACE_HPP
+#define NODE_VLE_TRACE_HPP
+
+#include <atomic>
+#include <ostream>
+#include <stdint.h>
+
+/*
+ * Opt-in timeline of the runs: begin and end of the experiment copies,
+ * model loading, simulations, conversions and deliveries to JavaScript,
+ * on every thread. Each thread records into its own ring buffer, without
+ * lock; only the newest events of a thread are kept. The events of one
+ * run carry its id, so that they can be followed across threads.
+ *
+ * While tracing is stopped, a span costs one test of a global flag.
+ * The dump is in the Chrome trace event format.
+ */
+
+extern std::atomic < bool > trace_enabled;
+
+inline bool tracing()
+{ return trace_enabled.load(std::memory_order_relaxed); }
+
+// ns on a steady clock
+int64_t trace_now();
+
+// a new run id, 0 while tracing is stopped
+uint64_t trace_next_id();
+
+void trace_record(const char* name, uint64_t run, int64_t begin,
+		  int64_t end);
+
+// names the calling thread in the dump
+void trace_thread_name(const char* name);
+
+// clears the buffers and starts recording, capacity events per thread
+void trace_start(unsigned int capacity);
+
+void trace_stop();
+
+// returns the number of events written
+uint64_t trace_dump(std::ostream& out);
+
+// run id of the spans opened by the calling thread
+class trace_run
+{
+public:
+  explicit trace_run(uint64_t id);
+  ~trace_run();
+
+  static uint64_t current();
+
+private:
+  trace_run(const trace_run&);
+  trace_run& operator=(const trace_run&);
+
+  uint64_t _previous;
+};
+
+// records the time between its construction and its destruction; name
+// must be a string literal
+class trace_span
+{
+public:
+  explicit trace_span(const char* name)
+    : _name(tracing() ? name : 0)
+  {
+    if (_name) {
+      _run = trace_run::current();
+      _begin = trace_now();
+    }
+  }
+
+  ~trace_span()
+  {
+    if (_name) {
+      trace_record(_name, _run, _begin, trace_now());
+    }
+  }
+
+private:
+  trace_span(const trace_span&);
+  trace_span& operator=(const trace_span&);
+
+  const char* _name;
+  uint64_t _run;
+  int64_t _begin;
+};
+
+#endif
@@ -1,37 +1,165 @@
 #include <vle/vle.hpp>
+#include <vle/manager/ExperimentGenerator.hpp>
 #include <vle/manager/Manager.hpp>
 #include <vle/manager/Simulation.hpp>
+#include <vle/devs/RootCoordinator.hpp>
 #include <vle/vpz/Vpz.hpp>
 #include <vle/utils/Package.hpp>
 
 #include <node.h>
 #include <node_object_wrap.h>
+#include <uv.h>
 #include <v8.h>
 
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cmath>
+#include <condition_variable>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <deque>
+#include <exception>
+#include <fstream>
 #include <iostream>
+#include <limits>
+#include <list>
+#include <map>
+#include <memory>
+#include <mutex>
+#include <set>
 #include <sstream>
+#include <stdexcept>
+#include <thread>
+#include <unordered_map>
+
+#include "affinity.hpp"
+#include "colfile.hpp"
+#include "compare.hpp"
+#include "compress.hpp"
+#include "memory.hpp"
+#include "optimizer.hpp"
+#include "result.hpp"
+#include "scheduler.hpp"
+#include "snapshot.hpp"
+#include "trace.hpp"
 
 using namespace vle;
 using namespace v8;
 
 static bool thread_init = false;
 
+static void ensure_init()
+{
+  if (!thread_init) {
+    vle::Init app;
+
+    thread_init = true;
+  }
+}
+
+// native bytes owned by a wrapper, reported to V8 so that the garbage
+// collector weighs the wrapper at its real size, and to vle.memory()
+class external_memory
+{
+public:
+  explicit external_memory(memory_accounting::category category)
+    : _category(category), _bytes(0)
+  { memory_accounting::instance().attach(category); }
+
+  ~external_memory()
+  {
+    update(0);
+    memory_accounting::instance().detach(_category);
+  }
+
+  uint64_t bytes() const
+  { return _bytes; }
+
+  // main thread
+  void update(uint64_t bytes)
+  {
+    int64_t delta = static_cast < int64_t >(bytes) -
+      static_cast < int64_t >(_bytes);
+
+    if (delta != 0) {
+      Isolate* isolate = Isolate::GetCurrent();
+
+      if (isolate) {
+	isolate->AdjustAmountOfExternalAllocatedMemory(delta);
+      }
+      memory_accounting::instance().add(_category, delta);
+      _bytes = bytes;
+    }
+  }
+
+private:
+  external_memory(const external_memory&);
+  external_memory& operator=(const external_memory&);
+
+  memory_accounting::category _category;
+  uint64_t _bytes;
+};
+
 class VleWrapper : public node::ObjectWrap
 {
 public:
   static void Init(Handle < Object > exports);
 
+  // size of the last result, for the estimate of the next runs
+  void record_result(uint64_t bytes)
+  { _result_bytes = bytes; }
+
 private:
+  typedef std::pair < std::string, std::string > port_key;
+  typedef std::map < port_key, uint64_t > port_epochs;
+
   vpz::Vpz* _vpz;
 
+  // modification epochs: each mutation of a condition port records a
+  // new epoch so that restore only puts back the ports touched since
+  // the snapshot was taken
+  uint64_t _id;
+  uint64_t _epoch;
+  uint64_t _created;            // last condition_create
+  uint64_t _outputs;            // last output_set_plugin
+  uint64_t _reset;              // snapshots older than this are restored in full
+  port_epochs _touched;
+
+  external_memory _memory;
+  uint64_t _sized;              // epoch of the size in _memory
+  uint64_t _result_bytes;
+
+  static uint64_t next_id()
+  {
+    static uint64_t id = 0;
+
+    return ++id;
+  }
+
+  void touch(const std::string& condition, const std::string& port)
+  { _touched[port_key(condition, port)] = ++_epoch; }
+
+  // memory a run of the experiment needs: its copy and a result the
+  // size of the last one. The size of the experiment changes with its
+  // conditions and outputs, whose mutations all take a new epoch: it is
+  // measured again only then.
+  uint64_t run_estimate()
+  {
+    if (_sized != _epoch) {
+      _memory.update(_vpz ? vpz_size(*_vpz) : 0);
+      _sized = _epoch;
+    }
+    return _memory.bytes() + _result_bytes;
+  }
+
   explicit VleWrapper(const char* pkg_name, const char* file_name)
+    : _vpz(0), _id(next_id()), _epoch(0), _created(0), _outputs(0), _reset(0),
+      _memory(memory_accounting::EXPERIMENTS), _sized(0), _result_bytes(0)
   {
     try {
-      if (!thread_init) {
-	vle::Init app;
-
-	thread_init = true;
-      }
+      ensure_init();
       utils::Package pack(pkg_name);
       std::string filepath = pack.getExpFile(file_name);
 
@@ -43,17 +171,31 @@ private:
       for (it = outlst.begin(); it != outlst.end(); ++it) {
         it->second.setLocalStream("", "storage", "vle.output");
       }
+      _memory.update(vpz_size(*_vpz));
     } catch(const std::exception& e) {
       _vpz = 0;
     }
   }
 
+  explicit VleWrapper(vpz::Vpz* vpz)
+    : _vpz(vpz), _id(next_id()), _epoch(0), _created(0), _outputs(0), _reset(0),
+      _memory(memory_accounting::EXPERIMENTS),
+      _sized(std::numeric_limits < uint64_t >::max()), _result_bytes(0)
+  { ensure_init(); }
+
   virtual ~VleWrapper()
   { if (_vpz) delete _vpz; }
 
   static Persistent<Function> constructor;
 
   static void New(const FunctionCallbackInfo<Value>& args);
+  static Local < Object > NewInstance(vpz::Vpz* vpz, Isolate* isolate);
+
+  static void save_snapshot(const FunctionCallbackInfo<Value>& args);
+  static void from_snapshot(const FunctionCallbackInfo<Value>& args);
+  static void snapshot(const FunctionCallbackInfo<Value>& args);
+  static void restore(const FunctionCallbackInfo<Value>& args);
+  static void clone(const FunctionCallbackInfo<Value>& args);
 
   static void experiment_set_begin(const FunctionCallbackInfo<Value>& args);
   static void experiment_get_begin(const FunctionCallbackInfo<Value>& args);
@@ -63,8 +205,13 @@ private:
   static void experiment_get_seed(const FunctionCallbackInfo<Value>& args);
 
   static void run(const FunctionCallbackInfo<Value>& args);
+  static void run_async(const FunctionCallbackInfo<Value>& args);
+  static void submit(const FunctionCallbackInfo<Value>& args);
   static void run_manager(const FunctionCallbackInfo<Value>& args);
   static void run_manager_thread(const FunctionCallbackInfo<Value>& args);
+  static void run_manager_pipeline(const FunctionCallbackInfo<Value>& args);
+  static void calibrate(const FunctionCallbackInfo<Value>& args);
+  static void calibrate_async(const FunctionCallbackInfo<Value>& args);
 
   static void condition_list(const FunctionCallbackInfo<Value>& args);
   static void condition_show(const FunctionCallbackInfo<Value>& args);
@@ -96,8 +243,9 @@ public:
 
 private:
   value::Value* _value;
+  external_memory _memory;
 
-  explicit ValueWrapper() : _value(0)
+  explicit ValueWrapper() : _value(0), _memory(memory_accounting::VALUES)
   { }
 
   virtual ~ValueWrapper()
@@ -110,8 +258,348 @@ private:
   static void get_type(const FunctionCallbackInfo<Value>& args);
 };
 
+class SnapshotWrapper : public node::ObjectWrap
+{
+public:
+  static void Init(Handle < Object > exports);
+
+  static Local < Object > NewInstance(experiment_state* state,
+				      uint64_t owner, uint64_t epoch,
+				      Isolate* isolate);
+
+  static bool HasInstance(Local < Value > value, Isolate* isolate);
+
+  const experiment_state* state() const
+  { return _state; }
+
+  uint64_t owner() const
+  { return _owner; }
+
+  uint64_t epoch() const
+  { return _epoch; }
+
+private:
+  experiment_state* _state;
+  uint64_t _owner;
+  uint64_t _epoch;
+  external_memory _memory;
+
+  explicit SnapshotWrapper()
+    : _state(0), _owner(0), _epoch(0), _memory(memory_accounting::SNAPSHOTS)
+  { }
+
+  virtual ~SnapshotWrapper()
+  { if (_state) delete _state; }
+
+  static Persistent<Function> constructor;
+  static Persistent<FunctionTemplate> tpl;
+
+  static void New(const FunctionCallbackInfo<Value>& args);
+};
+
+class ColumnFileWrapper : public node::ObjectWrap
+{
+public:
+  static void Init(Handle < Object > exports);
+
+  static Local < Object > NewInstance(column_file* file, Isolate* isolate);
+
+  static bool HasInstance(Local < Value > value, Isolate* isolate);
+
+  const column_file* file() const
+  { return _file; }
+
+private:
+  column_file* _file;
+
+  explicit ColumnFileWrapper() : _file(0)
+  { }
+
+  virtual ~ColumnFileWrapper()
+  { if (_file) delete _file; }
+
+  static Persistent<Function> constructor;
+  static Persistent<FunctionTemplate> tpl;
+
+  static void New(const FunctionCallbackInfo<Value>& args);
+
+  static void columns(const FunctionCallbackInfo<Value>& args);
+  static void rows(const FunctionCallbackInfo<Value>& args);
+  static void column(const FunctionCallbackInfo<Value>& args);
+  static void nulls(const FunctionCallbackInfo<Value>& args);
+};
+
+class CompressedResultWrapper : public node::ObjectWrap
+{
+public:
+  typedef std::vector < compressed_column > column_list;
+
+  static void Init(Handle < Object > exports);
+
+  static Local < Object > NewInstance(column_list* columns,
+				      Isolate* isolate);
+
+  static bool HasInstance(Local < Value > value, Isolate* isolate);
+
+  const column_list* columns() const
+  { return _columns; }
+
+  // index of the column or -1
+  int find(const std::string& name) const;
+
+private:
+  column_list* _columns;
+  external_memory _memory;
+
+  explicit CompressedResultWrapper()
+    : _columns(0), _memory(memory_accounting::RESULTS)
+  { }
+
+  virtual ~CompressedResultWrapper()
+  { if (_columns) delete _columns; }
+
+  static Persistent<Function> constructor;
+  static Persistent<FunctionTemplate> tpl;
+
+  static void New(const FunctionCallbackInfo<Value>& args);
+
+  static void columns(const FunctionCallbackInfo<Value>& args);
+  static void rows(const FunctionCallbackInfo<Value>& args);
+  static void column(const FunctionCallbackInfo<Value>& args);
+  static void nulls(const FunctionCallbackInfo<Value>& args);
+  static void info(const FunctionCallbackInfo<Value>& args);
+};
+
+/*  - - - - - - - - - - - - - --ooOoo-- - - - - - - - - - - -  */
+
+// Per isolate state of the conversions.
+//
+// Internalized strings used as property keys (time, view, model, port
+// and condition names) are created once and reused by every run, V8
+// then finds their hash and their hidden class transitions without
+// hashing the key again.
+//
+// The result object of a view is instantiated from an ObjectTemplate
+// derived from its columns the first time the view is seen: every
+// result of the view gets all its properties at once, with the same
+// hidden class from one run to the next, instead of growing through a
+// chain of transitions (or falling back to dictionary mode) property by
+// property.
+class marshal_cache
+{
+public:
+  static marshal_cache& get(Isolate* isolate)
+  {
+    static thread_local Isolate* last_isolate = 0;
+    static thread_local marshal_cache* last_cache = 0;
+
+    if (last_isolate == isolate) {
+      return *last_cache;
+    }
+
+    static std::mutex mutex;
+    static std::map < Isolate*, marshal_cache* > caches;
+    std::lock_guard < std::mutex > lock(mutex);
+    marshal_cache*& cache = caches[isolate];
+
+    if (not cache) {
+      cache = new marshal_cache(isolate);
+    }
+    last_isolate = isolate;
+    last_cache = cache;
+    return *cache;
+  }
+
+  Local < String > key(const std::string& name)
+  {
+    keys_t::iterator it = _keys.find(name);
+
+    if (it != _keys.end()) {
+      touch(_key_ages, it->second.age);
+      return Local < String >::New(_isolate, it->second.handle);
+    }
+    if (_keys.size() >= max_keys) {
+      evict(_keys, _key_ages);
+    }
+
+    Local < String > str = String::NewFromUtf8(_isolate, name.c_str(),
+					       String::kInternalizedString,
+					       name.size());
+
+    it = _keys.insert(std::make_pair(name, cached < String >())).first;
+    it->second.handle.Reset(_isolate, str);
+    _key_ages.push_front(&it->first);
+    it->second.age = _key_ages.begin();
+    return str;
+  }
+
+  // empty when the columns do not form a tree (a port and a model with
+  // the same name), the view is then built property by property
+  Local < ObjectTemplate > view_template(const std::string& view,
+					 const value::Matrix& matrix)
+  {
+    std::vector < std::string > headers;
+
+    for (unsigned int c = 0; c < matrix.columns(); ++c) {
+      headers.push_back(matrix.getString(c, 0));
+    }
+    return view_template(view, headers);
+  }
+
+  Local < ObjectTemplate > view_template(
+    const std::string& view, const std::vector < std::string >& headers)
+  {
+    std::string signature(view);
+
+    for (unsigned int c = 0; c < headers.size(); ++c) {
+      signature += '\n';
+      signature += headers[c];
+    }
+
+    shapes_t::iterator it = _shapes.find(signature);
+
+    if (it != _shapes.end()) {
+      touch(_shape_ages, it->second.age);
+      return Local < ObjectTemplate >::New(_isolate, it->second.handle);
+    }
+    if (_shapes.size() >= max_shapes) {
+      evict(_shapes, _shape_ages);
+    }
+
+    EscapableHandleScope scope(_isolate);
+    Local < ObjectTemplate > root = ObjectTemplate::New(_isolate);
+    std::map < std::string, Local < ObjectTemplate > > nodes;
+    std::set < std::string > leaves;
+    bool regular = true;
+
+    for (unsigned int c = 0; c < headers.size() and regular; ++c) {
+      std::vector < std::string > path;
+      Local < ObjectTemplate > parent = root;
+      std::string prefix;
+
+      if (headers[c] == "time") {
+	path.push_back("time");
+      } else {
+	build_path(headers[c], path);
+      }
+      for (unsigned int i = 0; i < path.size() - 1; ++i) {
+	prefix += path[i] + '\n';
+	if (leaves.count(prefix)) {
+	  regular = false;
+	  break;
+	}
+
+	std::map < std::string, Local < ObjectTemplate > >::iterator node =
+	  nodes.find(prefix);
+
+	if (node == nodes.end()) {
+	  Local < ObjectTemplate > child = ObjectTemplate::New(_isolate);
+
+	  parent->Set(key(path[i]), child);
+	  nodes[prefix] = child;
+	  parent = child;
+	} else {
+	  parent = node->second;
+	}
+      }
+      prefix += path.back() + '\n';
+      if (nodes.count(prefix) or leaves.count(prefix)) {
+	regular = false;
+      } else {
+	leaves.insert(prefix);
+	parent->Set(key(path.back()), Null(_isolate));
+      }
+    }
+
+    // an irregular view is kept with an empty template
+    it = _shapes.insert(std::make_pair(signature,
+				       cached < ObjectTemplate >())).first;
+    _shape_ages.push_front(&it->first);
+    it->second.age = _shape_ages.begin();
+    if (regular) {
+      it->second.handle.Reset(_isolate, root);
+    } else {
+      root = Local < ObjectTemplate >();
+    }
+    return scope.Escape(root);
+  }
+
+#ifdef NODE_VLE_BENCH
+  void clear()
+  {
+    _keys.clear();
+    _key_ages.clear();
+    _shapes.clear();
+    _shape_ages.clear();
+  }
+#endif
+
+private:
+  // most recently used first, points to the keys of a map
+  typedef std::list < const std::string* > ages_t;
+
+  template < typename T >
+  struct cached
+  {
+    Persistent < T, CopyablePersistentTraits < T > > handle;
+    ages_t::iterator age;
+  };
+
+  typedef std::unordered_map < std::string, cached < String > > keys_t;
+
+  // key: view name and column headers
+  typedef std::unordered_map < std::string,
+    cached < ObjectTemplate > > shapes_t;
+
+  // bounds the cache when many different schemas go through one process,
+  // the least recently used entry makes room for a new one
+  static const unsigned int max_keys = 1 << 16;
+  static const unsigned int max_shapes = 1 << 10;
+
+  explicit marshal_cache(Isolate* isolate) : _isolate(isolate)
+  { }
+
+  static void touch(ages_t& ages, ages_t::iterator age)
+  {
+    ages.splice(ages.begin(), ages, age);
+  }
+
+  template < typename M >
+  static void evict(M& map, ages_t& ages)
+  {
+    typename M::iterator it = map.find(*ages.back());
+
+    ages.pop_back();
+    map.erase(it);
+  }
+
+  Isolate* _isolate;
+  keys_t _keys;
+  ages_t _key_ages;
+  shapes_t _shapes;
+  ages_t _shape_ages;
+};
+
+inline Local < String > key(const std::string& name, Isolate* isolate)
+{
+  return marshal_cache::get(isolate).key(name);
+}
+
 /*  - - - - - - - - - - - - - --ooOoo-- - - - - - - - - - - -  */
 
+// one bulk copy into a new Float64Array
+Local < Float64Array > to_float64_array(const double* data, size_t size,
+					Isolate* isolate)
+{
+  Local < ArrayBuffer > buffer = ArrayBuffer::New(isolate,
+						  size * sizeof(double));
+
+  if (size > 0) {
+    std::memcpy(buffer->GetContents().Data(), data, size * sizeof(double));
+  }
+  return Float64Array::New(buffer, 0, size);
+}
+
 Handle < Value > convert_value(const value::Value& value,
 				Isolate* isolate)
 {
@@ -160,41 +648,57 @@ Handle < Value > convert_value(const value::Value& value,
     return scope.Escape(result);
   }
   case value::Value::TUPLE: {
-    Handle < Array > result = Array::New(isolate);
-    unsigned int i = 0;
-
-    for(std::vector < double >::const_iterator it = value.toTuple().
-	  value().begin(); it != value.toTuple().value().end(); ++it){
-      result->Set(i, Number::New(isolate, *it));
-      ++i;
-    }
-    return scope.Escape(result);
+    return scope.Escape(to_float64_array(value.toTuple().value().data(),
+					 value.toTuple().value().size(),
+					 isolate));
   }
   case value::Value::TABLE: {
-    Handle < Array > result = Array::New(isolate);
+    // data[x * height + y] == get(x, y), the storage order of the table
+    Handle < Object > result = Object::New(isolate);
+    Handle < Array > shape = Array::New(isolate, 2);
     const value::Table& t = value.toTable();
 
-    for (unsigned int i = 0; i < t.height(); i++){
-      Handle < Array > line = Array::New(isolate);
-
-      for (unsigned int j = 0; j < t.width(); j++){
-	result->Set(j, Number::New(isolate, t.get(j,i)));
-      }
-      result->Set(i, line);
-    }
+    shape->Set(0, Number::New(isolate, t.width()));
+    shape->Set(1, Number::New(isolate, t.height()));
+    result->Set(key("shape", isolate), shape);
+    result->Set(key("data", isolate),
+		to_float64_array(t.value().data(), t.width() * t.height(),
+				 isolate));
     return scope.Escape(result);
   }
   case value::Value::MATRIX: {
+    // one entry per row, a Float64Array when the row is numeric
     Handle < Array > result = Array::New(isolate);
     const value::Matrix& t = value.toMatrix();
+    std::vector < double > numbers(t.columns());
 
     for (unsigned int i = 0; i < t.rows(); i++){
-      Handle < Array > line = Array::New(isolate);
+      bool numeric = true;
+
+      // booleans and nulls keep their own type in a plain array
+      for (unsigned int j = 0; j < t.columns() and numeric; j++){
+	const value::Value* v = t.get(j,i);
 
-      for (unsigned int j = 0; j < t.columns(); j++){
-	result->Set(j, convert_value(*t.get(j,i), isolate));
+	numeric = v and (v->isDouble() or v->isInteger());
+	if (numeric) {
+	  numbers[j] = to_double(v);
+	}
+      }
+      if (numeric) {
+	result->Set(i, to_float64_array(numbers.data(), numbers.size(),
+					isolate));
+      } else {
+	Handle < Array > line = Array::New(isolate);
+
+	for (unsigned int j = 0; j < t.columns(); j++){
+	  if (t.get(j,i)) {
+	    line->Set(j, convert_value(*t.get(j,i), isolate));
+	  } else {
+	    line->Set(j, Null(isolate));
+	  }
+	}
+	result->Set(i, line);
       }
-      result->Set(i, line);
     }
     return scope.Escape(result);
   }
@@ -204,106 +708,137 @@ Handle < Value > convert_value(const value::Value& value,
   }
 }
 
-void split(const std::string& str, char delim, std::vector < std::string >& vec)
+void push(Local < Object >& dic, const std::vector < std::string >& path,
+	  Local < Value > value, Isolate* isolate)
 {
-  std::stringstream ss;
-  std::string item;
+  Local < Object > p = dic;
+  unsigned int index = 0;
+
+  while (index < path.size() - 1) {
+    Local < String > name = key(path[index], isolate);
+
+    if (not p->HasOwnProperty(name)) {
+      break;
+    }
+    p = Local < Object>::Cast(p->Get(name));
+    ++index;
+  }
+  if (index < path.size() - 1) {
+    for (unsigned int i = index; i < path.size() - 1; ++i) {
+      Local < Object > entry = Object::New(isolate);
 
-  ss.str(str);
-  while (getline(ss, item, delim)) {
-    vec.push_back(item);
+      p->Set(key(path[i], isolate), entry);
+      p = entry;
+    }
   }
+  p->Set(key(path.back(), isolate), value);
 }
 
-void build_path(const std::string& str, std::vector < std::string >& path)
+Local < Value > convert_sample(value::ConstVectorView& t, const row_sample& s,
+			       Isolate* isolate)
 {
-  // format: (,coupled_model)*:atomic_model.port
-  split(str, ',', path);
-  if (path[0].empty()) {
-    std::vector < std::string > path2;
-    std::vector < std::string > path3;
-
-    path.erase(path.begin());
-    split(path[path.size() - 1], ':', path2);
-    split(path2[path2.size() - 1], '.', path3);
-    path.pop_back();
-    path.push_back(path2[0]);
-    path.push_back(path3[0]);
-    path.push_back(path3[1]);
-  } else {
-    std::vector < std::string > path2;
-    std::vector < std::string > path3;
+  if (s.weight > 0) {
+    double a = to_double(t[s.row]);
+    double b = to_double(t[s.next]);
 
-    split(path[0], ':', path2);
-    split(path2[path2.size() - 1], '.', path3);
-    path.pop_back();
-    path.push_back(path3[0]);
-    path.push_back(path3[1]);
+    if (not std::isnan(a) and not std::isnan(b)) {
+      return Number::New(isolate, (1 - s.weight) * a + s.weight * b);
+    }
+  }
+  if (t[s.row]) {
+    return convert_value(*t[s.row], isolate);
   }
+  return Null(isolate);
 }
 
-void push(Local < Object >& dic, const std::vector < std::string > path,
-	  Local < Array >& value, Isolate* isolate)
+// sets a leaf of an object instantiated from a view template, parents
+// caches the nested objects already reached
+void assign(Local < Object >& v, const std::vector < std::string >& path,
+	    Local < Value > value,
+	    std::map < std::string, Local < Object > >& parents,
+	    Isolate* isolate)
 {
-  Local < Object > p = dic;
-  unsigned int index = 0;
+  Local < Object > p = v;
+  std::string prefix;
 
-  while (p->HasOwnProperty(String::NewFromUtf8(isolate, path[index].c_str()))) {
-    p = Local < Object>::Cast(p->Get(String::NewFromUtf8(isolate,
-							 path[index].c_str())));
-    ++index;
-  }
-  if (index < path.size() - 1) {
-    for (unsigned int i = index; i < path.size() - 1; ++i) {
-      Local < Object > entry = Object::New(isolate);
+  for (unsigned int i = 0; i < path.size() - 1; ++i) {
+    prefix += path[i] + '\n';
 
-      p->Set(String::NewFromUtf8(isolate, path[i].c_str()), entry);
-      p = entry;
+    std::map < std::string, Local < Object > >::iterator it =
+      parents.find(prefix);
+
+    if (it == parents.end()) {
+      p = Local < Object >::Cast(p->Get(key(path[i], isolate)));
+      parents[prefix] = p;
+    } else {
+      p = it->second;
     }
   }
-  p->Set(String::NewFromUtf8(isolate, path.back().c_str()), value);
+  p->Set(key(path.back(), isolate), value);
 }
 
 void build(Local < Object >& v, const value::Matrix& matrix,
-	   Isolate* isolate)
+	   Isolate* isolate, const view_filter* filter = 0,
+	   bool shaped = false)
 {
   value::ConstMatrixView view(matrix.value());
   unsigned int nbcol = matrix.columns();
   unsigned int nbline = view.shape()[1];
+  std::vector < row_sample > rows;
+  std::map < std::string, Local < Object > > parents;
 
+  select_rows(matrix, nbline, filter, rows);
   for(unsigned int c = 0; c < nbcol; c++){
     Local < Array > col = Array::New(isolate);
     value::ConstVectorView t = matrix.column(c);
 
     if (matrix.getString(c,0) == "time") {
-      for (unsigned int i = 1; i < nbline; ++i) {
-	col->Set(i - 1, convert_value(*t[i], isolate));
+      for (unsigned int i = 0; i < rows.size(); ++i) {
+	if (rows[i].resampled) {
+	  col->Set(i, Number::New(isolate, rows[i].time));
+	} else {
+	  col->Set(i, convert_value(*t[rows[i].row], isolate));
+	}
       }
-      v->Set(String::NewFromUtf8(isolate, "time"), col);
+      v->Set(key("time", isolate), col);
     } else {
       std::vector < std::string > path;
 
       build_path(matrix.getString(c,0), path);
-      for (unsigned int i = 1; i < nbline; ++i) {
-	if (t[i]) {
-	  col->Set(i - 1, convert_value(*t[i], isolate));
-	} else {
-	  col->Set(i - 1, Null(isolate));
-	}
+      for (unsigned int i = 0; i < rows.size(); ++i) {
+	col->Set(i, convert_sample(t, rows[i], isolate));
+      }
+      if (shaped) {
+	assign(v, path, col, parents, isolate);
+      } else {
+	push(v, path, col, isolate);
       }
-      push(v, path, col, isolate);
     }
   }
 }
 
-void convert(const value::Map& out, Local < Object >& result, Isolate* isolate)
+void convert(const value::Map& out, Local < Object >& result, Isolate* isolate,
+	     const view_filters* filters = 0)
 {
+  marshal_cache& cache = marshal_cache::get(isolate);
+
   for(value::Map::const_iterator itb = out.begin(); itb != out.end();
       ++itb) {
-    Local < Object > view = Object::New(isolate);
+    const value::Matrix& matrix = itb->second->toMatrix();
+    Local < ObjectTemplate > tpl = cache.view_template(itb->first, matrix);
+    Local < Object > view = tpl.IsEmpty() ? Object::New(isolate) :
+      tpl->NewInstance();
+    const view_filter* filter = 0;
+
+    if (filters) {
+      view_filters::const_iterator it = filters->find(itb->first);
 
-    build(view, itb->second->toMatrix(), isolate);
-    result->Set(String::NewFromUtf8(isolate, itb->first.c_str()), view);
+      if (it != filters->end()) {
+	filter = &it->second;
+      }
+    }
+    build(view, matrix, isolate, filter, not tpl.IsEmpty());
+    result->Set(key(itb->first, isolate), view);
   }
 }
 
@@ -323,32 +858,2005 @@ void convert_list(const value::Matrix& out, Local < Array >& result,
   }
 }
 
-/*  - - - - - - - - - - - - - --ooOoo-- - - - - - - - - - - -  */
-
-Persistent<Function> ValueWrapper::constructor;
-
-void ValueWrapper::Init(Handle<Object> exports)
+// wraps a transfer block without copying it: the block becomes the
+// backing store of one ArrayBuffer and every column a Float64Array view
+// on it; the null bitmaps are in the non enumerable "nulls" property,
+// by column name
+Local < Object > wrap_transfer(transfer_block& block, Isolate* isolate)
 {
-  Isolate* isolate = exports->GetIsolate();
-  Local<FunctionTemplate> tpl = FunctionTemplate::New(isolate, New);
+  EscapableHandleScope scope(isolate);
+  marshal_cache& cache = marshal_cache::get(isolate);
+  const std::vector < transfer_column >& columns = block.columns();
+  size_t size = block.size();
+  Local < ArrayBuffer > buffer = ArrayBuffer::New(
+    isolate, block.release(), size, ArrayBufferCreationMode::kInternalized);
+  Local < Object > result = Object::New(isolate);
+  Local < Object > nulls = Object::New(isolate);
+  unsigned int i = 0;
+
+  while (i < columns.size()) {
+    const std::string& view = columns[i].view;
+    std::vector < std::string > headers;
+    std::map < std::string, Local < Object > > parents;
+    unsigned int end = i;
+
+    while (end < columns.size() and columns[end].view == view) {
+      headers.push_back(columns[end++].header);
+    }
 
-  tpl->SetClassName(String::NewFromUtf8(isolate, "Value"));
-  tpl->InstanceTemplate()->SetInternalFieldCount(1);
+    Local < ObjectTemplate > tpl = cache.view_template(view, headers);
+    Local < Object > v = tpl.IsEmpty() ? Object::New(isolate) :
+      tpl->NewInstance();
 
-  // Prototype
-  NODE_SET_PROTOTYPE_METHOD(tpl, "get_type", get_type);
+    for (; i < end; ++i) {
+      const transfer_column& col = columns[i];
+      Local < Float64Array > data = Float64Array::New(buffer, col.data,
+						      col.rows);
 
-  constructor.Reset(isolate, tpl->GetFunction());
-  exports->Set(String::NewFromUtf8(isolate, "Value"),
-	       tpl->GetFunction());
+      if (tpl.IsEmpty()) {
+	push(v, col.path, data, isolate);
+      } else {
+	assign(v, col.path, data, parents, isolate);
+      }
+      if (col.nulls) {
+	nulls->Set(key(column_name(view, col.header), isolate),
+		   Uint8Array::New(buffer, col.nulls, (col.rows + 7) / 8));
+      }
+    }
+    result->Set(key(view, isolate), v);
+  }
+  result->DefineOwnProperty(isolate->GetCurrentContext(),
+			    String::NewFromUtf8(isolate, "nulls"),
+			    nulls, DontEnum).FromMaybe(false);
+  return scope.Escape(result);
 }
 
-value::Value* convert_to_vle(Local < Value > v)
+// shared delivery of a transfer block: the block becomes the backing
+// store of a SharedArrayBuffer and its layout is described by a plain
+// schema. Both are posted to worker_threads without copying the rows,
+// vle.attach() rebuilds the typed views on the other side.
+Local < Object > wrap_shared(transfer_block& block, Isolate* isolate)
 {
-    if (v->IsNumber()) {
-      Local < Number > arg = v->ToNumber();
-      double value = arg->Value();
-
+  EscapableHandleScope scope(isolate);
+  const std::vector < transfer_column >& columns = block.columns();
+  size_t size = block.size();
+  Local < SharedArrayBuffer > buffer = SharedArrayBuffer::New(
+    isolate, block.release(), size, ArrayBufferCreationMode::kInternalized);
+  Local < Object > result = Object::New(isolate);
+  Local < Object > schema = Object::New(isolate);
+  Local < Array > list = Array::New(isolate, columns.size());
+
+  for (unsigned int i = 0; i < columns.size(); ++i) {
+    const transfer_column& col = columns[i];
+    Local < Object > c = Object::New(isolate);
+    Local < Array > path = Array::New(isolate, col.path.size());
+
+    for (unsigned int j = 0; j < col.path.size(); ++j) {
+      path->Set(j, key(col.path[j], isolate));
+    }
+    c->Set(String::NewFromUtf8(isolate, "view"), key(col.view, isolate));
+    c->Set(String::NewFromUtf8(isolate, "name"),
+	   key(column_name(col.view, col.header), isolate));
+    c->Set(String::NewFromUtf8(isolate, "path"), path);
+    c->Set(String::NewFromUtf8(isolate, "offset"),
+	   Number::New(isolate, col.data));
+    c->Set(String::NewFromUtf8(isolate, "rows"),
+	   Number::New(isolate, col.rows));
+    if (col.nulls) {
+      c->Set(String::NewFromUtf8(isolate, "nulls"),
+	     Number::New(isolate, col.nulls));
+    } else {
+      c->Set(String::NewFromUtf8(isolate, "nulls"), Null(isolate));
+    }
+    list->Set(i, c);
+  }
+  schema->Set(String::NewFromUtf8(isolate, "version"),
+	      Number::New(isolate, 1));
+  schema->Set(String::NewFromUtf8(isolate, "byte_length"),
+	      Number::New(isolate, size));
+  schema->Set(String::NewFromUtf8(isolate, "columns"), list);
+  result->Set(String::NewFromUtf8(isolate, "buffer"), buffer);
+  result->Set(String::NewFromUtf8(isolate, "schema"), schema);
+  return scope.Escape(result);
+}
+
+void configure_storage(vpz::Vpz& vpz)
+{
+  //configure output plugins for column names
+  for(vpz::Outputs::iterator it =
+	vpz.project().experiment().views().outputs().begin();
+      it != vpz.project().experiment().views().outputs().end(); ++it) {
+    vpz::Output& output = it->second;
+
+    if (output.package() == "vle.output" and
+	output.plugin() == "storage") {
+      value::Map* configOutput = new value::Map();
+
+      configOutput->addString("header", "top");
+      output.setData(configOutput);
+    }
+  }
+}
+
+// replaces the storage plugins by the vle.output "file" plugin so that
+// the observations are written to csv files during the run instead of
+// kept in memory, one directory per output
+void configure_file_outputs(vpz::Vpz& vpz, const scratch_directory& scratch,
+			    std::vector < csv_output >& files)
+{
+  vpz::Views& views = vpz.project().experiment().views();
+  std::map < std::string, std::string > directories;
+  unsigned int n = 0;
+
+  for (vpz::Outputs::iterator it = views.outputs().begin();
+       it != views.outputs().end(); ++it) {
+    vpz::Output& output = it->second;
+
+    if (output.package() == "vle.output" and
+	output.plugin() == "storage") {
+      value::Map* configOutput = new value::Map();
+      std::ostringstream name;
+
+      name << n++;
+      directories[it->first] = scratch.make(name.str());
+      configOutput->addString("type", "csv");
+      configOutput->addString("output", "file");
+      output.setLocalStream(directories[it->first], "file", "vle.output");
+      output.setData(configOutput);
+    }
+  }
+  for (vpz::ViewList::const_iterator it = views.viewlist().begin();
+       it != views.viewlist().end(); ++it) {
+    std::map < std::string, std::string >::const_iterator dir =
+      directories.find(it->second.output());
+
+    if (dir != directories.end()) {
+      csv_output file = { it->first, dir->second };
+
+      files.push_back(file);
+    }
+  }
+}
+
+/*  - - - - - - - - - - - - - --ooOoo-- - - - - - - - - - - -  */
+
+bool to_doubles(Local < Value > v, std::vector < double >& result)
+{
+  if (v->IsFloat64Array()) {
+    Local < Float64Array > array = Local < Float64Array >::Cast(v);
+
+    result.resize(array->Length());
+    array->CopyContents(result.data(), result.size() * sizeof(double));
+    return true;
+  } else if (v->IsArray() or v->IsTypedArray()) {
+    Local < Object > array = Local < Object >::Cast(v);
+    unsigned int size = v->IsArray() ? Local < Array >::Cast(v)->Length() :
+      Local < TypedArray >::Cast(v)->Length();
+
+    result.resize(size);
+    for (unsigned int i = 0; i < size; ++i) {
+      Local < Value > item = array->Get(i);
+
+      result[i] = item->IsNumber() ? item->NumberValue() :
+	std::numeric_limits < double >::quiet_NaN();
+    }
+    return true;
+  }
+  return false;
+}
+
+/*  - - - - - - - - - - - - - --ooOoo-- - - - - - - - - - - -  */
+
+struct stop_predicate
+{
+  std::string column;
+  std::string op;
+  double value;
+
+  bool match(double x) const
+  {
+    if (std::isnan(x)) {
+      return false;
+    }
+    if (op == "<") return x < value;
+    if (op == "<=") return x <= value;
+    if (op == ">") return x > value;
+    if (op == ">=") return x >= value;
+    if (op == "==") return x == value;
+    if (op == "!=") return x != value;
+    return false;
+  }
+};
+
+// early termination of a simulation: predicates on the last observed
+// row of a column and a wall time budget
+struct run_control
+{
+  run_control()
+    : max_wall_time(0), check_interval(0), cancel(0), stopped(false),
+      stop_time(0)
+  { }
+
+  // no stop condition of the user; the cancel flag of the scheduler is
+  // not one, it adds no stop status to the result
+  bool empty() const
+  { return predicates.empty() and max_wall_time <= 0; }
+
+  std::vector < stop_predicate > predicates;
+  double max_wall_time;     // milliseconds, 0: no budget
+  double check_interval;    // simulation time between two predicate checks
+  const std::atomic < bool >* cancel;  // raised by the scheduler
+
+  bool stopped;
+  std::string reason;
+  double stop_time;
+};
+
+// view added to a run with stop predicates and its output
+const char* const stop_view = "node_vle_stop";
+
+// the ports observed by the views of the predicates are also observed by
+// a timed view written to a csv file by the vle.output "file" plugin, so
+// that a check reads the last row of that file instead of copying every
+// storage matrix. columns gets the name of each predicate column in that
+// view, empty when the predicate names no view of the experiment
+void configure_stop_view(vpz::Vpz& vpz, const run_control& control,
+			 double interval, const scratch_directory& scratch,
+			 csv_output& watched,
+			 std::vector < std::string >& columns)
+{
+  vpz::Views& views = vpz.project().experiment().views();
+  std::set < std::string > observed;
+  value::Map* config = new value::Map();
+
+  for (unsigned int i = 0; i < control.predicates.size(); ++i) {
+    const std::string& column = control.predicates[i].column;
+    std::string view;
+
+    // the longest view name, view names may hold dots
+    for (vpz::ViewList::const_iterator it = views.viewlist().begin();
+	 it != views.viewlist().end(); ++it) {
+      if (it->first.size() > view.size() and
+	  column.size() > it->first.size() and
+	  column.compare(0, it->first.size(), it->first) == 0 and
+	  column[it->first.size()] == '.') {
+	view = it->first;
+      }
+    }
+    columns.push_back(view.empty() ? std::string() :
+		      stop_view + column.substr(view.size()));
+    if (not view.empty()) {
+      observed.insert(view);
+    }
+  }
+
+  config->addString("type", "csv");
+  config->addString("output", "file");
+  views.outputs().addLocalStream(stop_view, scratch.make("stop"), "file",
+				 "vle.output").setData(config);
+  views.addTimedView(stop_view, interval, stop_view);
+
+  for (vpz::ObservableList::const_iterator it =
+	 views.observables().observablelist().begin();
+       it != views.observables().observablelist().end(); ++it) {
+    for (vpz::ObservablePortList::const_iterator port =
+	   it->second.observableportlist().begin();
+	 port != it->second.observableportlist().end(); ++port) {
+      const vpz::ObservablePort::ViewNameList& names =
+	port->second.viewnamelist();
+
+      for (unsigned int v = 0; v < names.size(); ++v) {
+	if (observed.count(names[v])) {
+	  views.observables().get(it->first).get(port->first).add(stop_view);
+	  break;
+	}
+      }
+    }
+  }
+  watched.view = stop_view;
+  watched.directory = scratch.path() + "/stop";
+}
+
+bool check_predicates(const csv_output& watched,
+		      const std::vector < std::string >& columns,
+		      run_control& control)
+{
+  std::vector < std::string > names;
+  std::vector < double > values;
+
+  if (not read_last_row(watched, names, values)) {
+    return false;
+  }
+  for (unsigned int i = 0; i < control.predicates.size(); ++i) {
+    const stop_predicate& p = control.predicates[i];
+    std::vector < std::string >::const_iterator column =
+      std::find(names.begin(), names.end(), columns[i]);
+
+    if (not columns[i].empty() and column != names.end() and
+	p.match(values[column - names.begin()])) {
+      std::ostringstream reason;
+
+      reason << p.column << ' ' << p.op << ' ' << p.value;
+      control.reason = reason.str();
+      return true;
+    }
+  }
+  return false;
+}
+
+// scratch directory of the stop view, in TMPDIR
+std::string stop_directory()
+{
+  const char* tmp = std::getenv("TMPDIR");
+
+  return std::string(tmp and *tmp ? tmp : P_tmpdir) + "/node-vle-stop";
+}
+
+// runs one simulation for every entry point: drives the root coordinator
+// one bag at a time so that the control can interrupt it, and throws the
+// errors of the model. Takes ownership of vpz
+value::Map* simulate(vpz::Vpz* vpz, const utils::ModuleManager& modules,
+		     run_control& control)
+{
+  std::chrono::steady_clock::time_point start =
+    std::chrono::steady_clock::now();
+  devs::RootCoordinator root(modules);
+  double duration = vpz->project().experiment().duration();
+  double interval = control.check_interval > 0 ? control.check_interval :
+    duration / 100;
+  std::unique_ptr < scratch_directory > scratch;
+  csv_output watched;
+  std::vector < std::string > columns;
+
+  {
+    std::unique_ptr < vpz::Vpz > owner(vpz);
+    trace_span span("load");
+
+    if (not control.predicates.empty()) {
+      scratch.reset(new scratch_directory(stop_directory()));
+      configure_stop_view(*vpz, control, interval, *scratch, watched,
+			  columns);
+    }
+    root.load(*vpz);
+  }
+
+  trace_span span("simulate");
+
+  root.init();
+
+  double next_check = root.getCurrentTime() + interval;
+
+  while (root.run()) {
+    if (control.cancel and control.cancel->load(std::memory_order_relaxed)) {
+      control.stopped = true;
+      control.reason = "cancelled";
+      break;
+    }
+    if (control.max_wall_time > 0 and
+	std::chrono::duration < double, std::milli >(
+	  std::chrono::steady_clock::now() - start).count() >=
+	control.max_wall_time) {
+      control.stopped = true;
+      control.reason = "max_wall_time";
+      break;
+    }
+    if (not control.predicates.empty() and
+	root.getCurrentTime() >= next_check) {
+      // the check sees the rows the plugin has written so far
+      next_check = root.getCurrentTime() + interval;
+      if (check_predicates(watched, columns, control)) {
+	control.stopped = true;
+	break;
+      }
+    }
+  }
+  control.stop_time = root.getCurrentTime();
+  root.finish();
+
+  value::Map* out = root.outputs();
+
+  if (out and scratch) {
+    value::MapValue::iterator it = out->value().find(stop_view);
+
+    if (it != out->value().end()) {
+      delete it->second;
+      out->value().erase(it);
+    }
+  }
+  return out;
+}
+
+bool parse_run_control(Local < Object > opts, run_control& control,
+		       Isolate* isolate)
+{
+  Local < Value > stop = opts->Get(String::NewFromUtf8(isolate, "stop"));
+  Local < Value > wall = opts->Get(String::NewFromUtf8(isolate,
+						       "max_wall_time"));
+  Local < Value > interval = opts->Get(String::NewFromUtf8(isolate,
+							   "check_interval"));
+
+  if (stop->IsArray()) {
+    Local < Array > lst = Local < Array >::Cast(stop);
+
+    for (unsigned int i = 0; i < lst->Length(); ++i) {
+      Local < Object > item = lst->Get(i)->ToObject();
+      stop_predicate p;
+
+      p.column = *String::Utf8Value(item->Get(String::NewFromUtf8(isolate,
+								  "column")));
+      p.op = *String::Utf8Value(item->Get(String::NewFromUtf8(isolate, "op")));
+      p.value = item->Get(String::NewFromUtf8(isolate, "value"))->
+	NumberValue();
+      if (p.op != "<" and p.op != "<=" and p.op != ">" and p.op != ">=" and
+	  p.op != "==" and p.op != "!=") {
+	isolate->ThrowException(Exception::RangeError(
+	    String::NewFromUtf8(isolate, ("stop: unknown operator " +
+					  p.op).c_str())));
+	return false;
+      }
+      control.predicates.push_back(p);
+    }
+  }
+  if (wall->IsNumber()) {
+    control.max_wall_time = wall->NumberValue();
+  }
+  if (interval->IsNumber()) {
+    control.check_interval = interval->NumberValue();
+  }
+  return true;
+}
+
+// synchronous runs cannot wait for memory without blocking the loop
+// that releases it: over the budget, they fail at once
+bool reserve_run(memory_reservation& reserved, uint64_t bytes,
+		 Isolate* isolate)
+{
+  try {
+    reserved.acquire(bytes, false);
+  } catch(const memory_exceeded& e) {
+    isolate->ThrowException(Exception::Error(
+	String::NewFromUtf8(isolate, e.what())));
+    return false;
+  }
+  return true;
+}
+
+// adds stopped, stop_time and stop_reason when a control was given
+void set_stop_status(Local < Object > result, const run_control& control,
+		     Isolate* isolate)
+{
+  if (not control.empty()) {
+    result->Set(String::NewFromUtf8(isolate, "stopped"),
+		Boolean::New(isolate, control.stopped));
+    if (control.stopped) {
+      result->Set(String::NewFromUtf8(isolate, "stop_time"),
+		  Number::New(isolate, control.stop_time));
+      result->Set(String::NewFromUtf8(isolate, "stop_reason"),
+		  String::NewFromUtf8(isolate, control.reason.c_str()));
+    }
+  }
+}
+
+bool parse_view_filters(Local < Object > opts, view_filters& filters,
+			Isolate* isolate)
+{
+  Local < Value > views = opts->Get(String::NewFromUtf8(isolate, "views"));
+
+  if (not views->IsObject()) {
+    return true;
+  }
+
+  Local < Array > names = views->ToObject()->GetOwnPropertyNames();
+
+  for (unsigned int i = 0; i < names->Length(); ++i) {
+    Local < Object > item = views->ToObject()->Get(names->Get(i))->ToObject();
+    Local < Value > every = item->Get(String::NewFromUtf8(isolate, "every"));
+    Local < Value > window = item->Get(String::NewFromUtf8(isolate, "window"));
+    Local < Value > grid = item->Get(String::NewFromUtf8(isolate, "grid"));
+    Local < Value > interpolation = item->Get(
+      String::NewFromUtf8(isolate, "interpolation"));
+    view_filter filter;
+
+    if (every->IsNumber()) {
+      filter.every = std::max(1u, every->Uint32Value());
+    }
+    if (window->IsArray() and Local < Array >::Cast(window)->Length() == 2) {
+      filter.begin = Local < Array >::Cast(window)->Get(0)->NumberValue();
+      filter.end = Local < Array >::Cast(window)->Get(1)->NumberValue();
+    }
+    if (grid->IsNumber()) {
+      filter.grid = grid->NumberValue();
+    }
+    if (filter.every > 1 and filter.grid > 0) {
+      isolate->ThrowException(Exception::RangeError(
+	  String::NewFromUtf8(isolate, ("views: every and grid cannot be "
+					"combined in " +
+					std::string(*String::Utf8Value(
+						      names->Get(i)))).c_str())));
+      return false;
+    }
+    if (interpolation->IsString()) {
+      std::string type = *String::Utf8Value(interpolation);
+
+      if (type != "last" and type != "linear") {
+	isolate->ThrowException(Exception::RangeError(
+	    String::NewFromUtf8(isolate, ("views: unknown interpolation " +
+					  type).c_str())));
+	return false;
+      }
+      filter.linear = type == "linear";
+    }
+    filters[*String::Utf8Value(names->Get(i))] = filter;
+  }
+  return true;
+}
+
+// timed views are decimated at the source: observing less often keeps
+// the storage matrix small. The storage plugin has no window, the other
+// filters only apply to the stored result and do not lower the peak
+void apply_view_filters(vpz::Vpz& vpz, view_filters& filters)
+{
+  vpz::Views& views(vpz.project().experiment().views());
+
+  for (view_filters::iterator it = filters.begin(); it != filters.end();
+       ++it) {
+    view_filter& filter = it->second;
+
+    if (not views.exist(it->first) or
+	views.get(it->first).type() != vpz::View::TIMED) {
+      continue;
+    }
+
+    vpz::View& view = views.get(it->first);
+
+    if (filter.grid > 0) {
+      if (not filter.linear and std::isinf(filter.begin)) {
+	view.setTimestep(filter.grid);
+	filter.grid = 0;
+      }
+    } else if (filter.every > 1 and std::isinf(filter.begin)) {
+      // the first row of a timed view is at the beginning of the
+      // experiment: counted from there, as in the conversion. With a
+      // window, rows are counted from its first row by the conversion.
+      view.setTimestep(view.timestep() * filter.every);
+      filter.every = 1;
+    }
+  }
+}
+
+/*  - - - - - - - - - - - - - --ooOoo-- - - - - - - - - - - -  */
+
+// run_async and submit job: the simulation and the flattening of its
+// result into a transfer block happen on a thread of the scheduler pool,
+// the main thread only wraps the block and calls back
+struct async_run
+{
+  async_run()
+    : vpz(0), shared(false), memory(0), result_bytes(0), trace_id(0),
+      queued(0), finished(0)
+  { }
+
+  ~async_run()
+  {
+    delete vpz;
+    self.Reset();
+    callback.Reset();
+  }
+
+  vpz::Vpz* vpz;
+  run_control control;
+  view_filters filters;
+  bool shared;
+  uint64_t memory;              // estimate reserved while running
+  uint64_t result_bytes;
+  uint64_t trace_id;
+  int64_t queued;               // trace clock, 0 while not tracing
+  int64_t finished;
+  transfer_block block;
+  std::string error;
+  Persistent < Object > self;
+  Persistent < Function > callback;
+};
+
+// simulation and flattening, on a worker thread
+void async_run_execute(async_run* job)
+{
+  std::unique_ptr < vpz::Vpz > vpz(job->vpz);
+  trace_run traced(job->trace_id);
+
+  if (job->queued and tracing()) {
+    trace_record("queued", job->trace_id, job->queued, trace_now());
+  }
+  job->vpz = 0;
+  try {
+    // may wait here for memory, on the worker thread
+    memory_reservation reserved(job->memory, true, job->control.cancel);
+    utils::ModuleManager man;
+    std::unique_ptr < value::Map > res;
+
+    res.reset(simulate(vpz.release(), man, job->control));
+    if (job->control.stopped and job->control.reason == "cancelled") {
+      job->error = "cancelled";
+    } else if (res) {
+      trace_span span("convert");
+
+      job->result_bytes = value_size(res.get());
+      job->block.fill(*res, &job->filters);
+    } else {
+      job->error = "simulation failed";
+    }
+  } catch(const memory_exceeded& e) {
+    // a cancel ends the wait for memory
+    job->error = job->control.cancel and *job->control.cancel ?
+      "cancelled" : e.what();
+  } catch(const std::exception& e) {
+    job->error = e.what();
+  }
+  job->finished = job->queued ? trace_now() : 0;
+}
+
+// wraps the result and calls back on the main thread, deletes the job
+void async_run_deliver(async_run* job)
+{
+  std::unique_ptr < async_run > owner(job);
+  Isolate* isolate = Isolate::GetCurrent();
+  HandleScope scope(isolate);
+  Local < Value > argv[2];
+  trace_run traced(job->trace_id);
+
+  // from the end of the work to the main thread
+  if (job->finished and tracing()) {
+    trace_record("marshal", job->trace_id, job->finished, trace_now());
+  }
+
+  trace_span span("deliver");
+
+  if (job->error.empty()) {
+    node::ObjectWrap::Unwrap < VleWrapper >(
+      Local < Object >::New(isolate, job->self))->record_result(
+	job->result_bytes);
+  }
+
+  if (job->error.empty()) {
+    Local < Object > result = job->shared ?
+      wrap_shared(job->block, isolate) : wrap_transfer(job->block, isolate);
+
+    set_stop_status(result, job->control, isolate);
+    argv[0] = Null(isolate);
+    argv[1] = result;
+  } else {
+    argv[0] = Exception::Error(String::NewFromUtf8(isolate,
+						   job->error.c_str()));
+    argv[1] = Null(isolate);
+  }
+  node::MakeCallback(isolate, Local < Object >::New(isolate, job->self),
+		     Local < Function >::New(isolate, job->callback), 2, argv);
+}
+
+/*  - - - - - - - - - - - - - --ooOoo-- - - - - - - - - - - -  */
+
+// Jobs of the process wide scheduler (Vle.run_async and Vle.submit) are
+// async_run jobs executed by the scheduler pool. Their completions are handed to the
+// main thread through one uv_async handle, referenced only while jobs
+// are pending so that an idle scheduler does not keep node alive.
+class scheduler_bridge
+{
+public:
+  static scheduler_bridge& get()
+  {
+    static scheduler_bridge* bridge = new scheduler_bridge();
+
+    return *bridge;
+  }
+
+  // main thread
+  void submitted()
+  {
+    if (_pending++ == 0) {
+      uv_ref(reinterpret_cast < uv_handle_t* >(&_async));
+    }
+  }
+
+  // any thread
+  void post(async_run* job)
+  {
+    {
+      std::lock_guard < std::mutex > lock(_mutex);
+
+      _done.push_back(job);
+    }
+    uv_async_send(&_async);
+  }
+
+private:
+  scheduler_bridge() : _pending(0)
+  {
+    uv_async_init(uv_default_loop(), &_async, deliver);
+    _async.data = this;
+    uv_unref(reinterpret_cast < uv_handle_t* >(&_async));
+  }
+
+  static void deliver(uv_async_t* handle)
+  {
+    scheduler_bridge* bridge = static_cast < scheduler_bridge* >(
+      handle->data);
+    std::vector < async_run* > done;
+
+    {
+      std::lock_guard < std::mutex > lock(bridge->_mutex);
+
+      done.swap(bridge->_done);
+    }
+    for (unsigned int i = 0; i < done.size(); ++i) {
+      async_run_deliver(done[i]);
+      if (--bridge->_pending == 0) {
+	uv_unref(reinterpret_cast < uv_handle_t* >(&bridge->_async));
+      }
+    }
+  }
+
+  uv_async_t _async;
+  std::mutex _mutex;
+  std::vector < async_run* > _done;
+  unsigned int _pending;
+};
+
+// VLE's manager runs threads of its own: while it runs, as many threads
+// of the scheduler pool are held idle, so that the process never runs
+// more simulations at once than the pool has threads
+class pool_lease
+{
+public:
+  explicit pool_lease(unsigned int count)
+    : _count(std::min(count, scheduler::instance().size())), _held(0),
+      _released(false)
+  {
+    for (unsigned int i = 0; i < _count; ++i) {
+      _group.run([this]() {
+	  std::unique_lock < std::mutex > lock(_mutex);
+
+	  ++_held;
+	  _changed.notify_all();
+	  _changed.wait(lock, [this]() { return _released; });
+	});
+    }
+
+    std::unique_lock < std::mutex > lock(_mutex);
+
+    _changed.wait(lock, [this]() { return _held == _count; });
+  }
+
+  ~pool_lease()
+  {
+    {
+      std::lock_guard < std::mutex > lock(_mutex);
+
+      _released = true;
+    }
+    _changed.notify_all();
+    _group.wait();
+  }
+
+private:
+  pool_lease(const pool_lease&);
+  pool_lease& operator=(const pool_lease&);
+
+  std::mutex _mutex;
+  std::condition_variable _changed;
+  unsigned int _count;
+  unsigned int _held;
+  bool _released;
+  job_group _group;
+};
+
+bool parse_priority(Local < Value > v, scheduler::priority& level,
+		    Isolate* isolate)
+{
+  std::string name = v->IsString() ? *String::Utf8Value(v) : "normal";
+
+  if (name == "interactive") {
+    level = scheduler::INTERACTIVE;
+  } else if (name == "normal") {
+    level = scheduler::NORMAL;
+  } else if (name == "batch") {
+    level = scheduler::BATCH;
+  } else {
+    isolate->ThrowException(Exception::RangeError(
+	String::NewFromUtf8(isolate, ("unknown priority " + name).c_str())));
+    return false;
+  }
+  return true;
+}
+
+void scheduler_cancel(const FunctionCallbackInfo<Value>& args)
+{
+  Isolate* isolate = args.GetIsolate();
+  uint64_t id = static_cast < uint64_t >(args[0]->NumberValue());
+
+  args.GetReturnValue().Set(Boolean::New(
+			      isolate, scheduler::instance().cancel(id)));
+}
+
+void scheduler_set_quota(const FunctionCallbackInfo<Value>& args)
+{
+  Isolate* isolate = args.GetIsolate();
+
+  if (args.Length() < 2 or not args[1]->IsNumber()) {
+    isolate->ThrowException(Exception::TypeError(
+	String::NewFromUtf8(isolate, "set_quota: tenant and count expected")));
+    return;
+  }
+  scheduler::instance().set_quota(*String::Utf8Value(args[0]->ToString()),
+				  args[1]->Uint32Value());
+}
+
+// placement option of the parallel entry points: "compact", "spread",
+// "none" or an array of cpus
+bool parse_placement(Local < Value > v, placement& where, Isolate* isolate)
+{
+  if (v->IsUndefined() or v->IsNull()) {
+    where = placement();
+  } else if (v->IsString()) {
+    std::string name = *String::Utf8Value(v);
+    placement::policy kind;
+
+    if (not parse_policy(name, kind)) {
+      isolate->ThrowException(Exception::RangeError(
+	  String::NewFromUtf8(isolate,
+			      ("unknown placement " + name).c_str())));
+      return false;
+    }
+    where = placement(kind, std::vector < int >());
+  } else if (v->IsArray()) {
+    Local < Array > list = Local < Array >::Cast(v);
+    std::vector < int > cpus;
+
+    for (unsigned int i = 0; i < list->Length(); ++i) {
+      Local < Value > cpu = list->Get(i);
+
+      if (not cpu->IsNumber() or cpu->NumberValue() < 0) {
+	isolate->ThrowException(Exception::TypeError(
+	    String::NewFromUtf8(isolate, "placement: cpu numbers expected")));
+	return false;
+      }
+      if (cpu->NumberValue() != cpu->Int32Value() or
+	  not cpu_usable(cpu->Int32Value())) {
+	isolate->ThrowException(Exception::RangeError(
+	    String::NewFromUtf8(isolate, ("placement: cpu " +
+					  std::string(*String::Utf8Value(cpu)) +
+					  " is not usable").c_str())));
+	return false;
+      }
+      cpus.push_back(cpu->Int32Value());
+    }
+    where = placement(placement::LIST, cpus);
+  } else {
+    isolate->ThrowException(Exception::TypeError(
+	String::NewFromUtf8(isolate,
+			    "placement: policy name or cpu list expected")));
+    return false;
+  }
+  return true;
+}
+
+void scheduler_set_placement(const FunctionCallbackInfo<Value>& args)
+{
+  Isolate* isolate = args.GetIsolate();
+  placement where;
+
+  if (parse_placement(args[0], where, isolate)) {
+    scheduler::instance().set_placement(where);
+  }
+}
+
+// {nodes: [[cpu, ...], ...]}, the cpus this process may use by node
+void topology(const FunctionCallbackInfo<Value>& args)
+{
+  Isolate* isolate = args.GetIsolate();
+  const cpu_topology& topo = cpu_topology::get();
+  Local < Object > result = Object::New(isolate);
+  Local < Array > nodes = Array::New(isolate, topo.nodes.size());
+
+  for (unsigned int n = 0; n < topo.nodes.size(); ++n) {
+    Local < Array > cpus = Array::New(isolate, topo.nodes[n].size());
+
+    for (unsigned int i = 0; i < topo.nodes[n].size(); ++i) {
+      cpus->Set(i, Number::New(isolate, topo.nodes[n][i]));
+    }
+    nodes->Set(n, cpus);
+  }
+  result->Set(String::NewFromUtf8(isolate, "nodes"), nodes);
+  args.GetReturnValue().Set(result);
+}
+
+// {node: count}
+Local < Object > node_counts(const std::map < int, uint64_t >& counts,
+			     Isolate* isolate)
+{
+  Local < Object > result = Object::New(isolate);
+
+  for (std::map < int, uint64_t >::const_iterator it = counts.begin();
+       it != counts.end(); ++it) {
+    result->Set(Number::New(isolate, it->first),
+		Number::New(isolate, it->second));
+  }
+  return result;
+}
+
+void scheduler_stats(const FunctionCallbackInfo<Value>& args)
+{
+  static const char* names[scheduler::PRIORITIES] = {
+    "interactive", "normal", "batch" };
+  Isolate* isolate = args.GetIsolate();
+  scheduler::stats stats;
+  Local < Object > result = Object::New(isolate);
+  Local < Object > classes = Object::New(isolate);
+  Local < Object > tenants = Object::New(isolate);
+
+  scheduler::instance().get_stats(stats);
+  for (unsigned int i = 0; i < scheduler::PRIORITIES; ++i) {
+    Local < Object > c = Object::New(isolate);
+
+    c->Set(String::NewFromUtf8(isolate, "queued"),
+	   Number::New(isolate, stats.queued[i]));
+    c->Set(String::NewFromUtf8(isolate, "started"),
+	   Number::New(isolate, stats.started[i]));
+    c->Set(String::NewFromUtf8(isolate, "mean_wait"),
+	   Number::New(isolate, stats.started[i] ?
+		       stats.wait_total[i] / stats.started[i] : 0.0));
+    c->Set(String::NewFromUtf8(isolate, "max_wait"),
+	   Number::New(isolate, stats.wait_max[i]));
+    classes->Set(String::NewFromUtf8(isolate, names[i]), c);
+  }
+  for (std::map < std::string, scheduler::tenant_stats >::const_iterator it =
+	 stats.tenants.begin(); it != stats.tenants.end(); ++it) {
+    Local < Object > t = Object::New(isolate);
+
+    t->Set(String::NewFromUtf8(isolate, "queued"),
+	   Number::New(isolate, it->second.queued));
+    t->Set(String::NewFromUtf8(isolate, "running"),
+	   Number::New(isolate, it->second.running));
+    t->Set(String::NewFromUtf8(isolate, "quota"),
+	   Number::New(isolate, it->second.quota));
+    tenants->Set(key(it->first, isolate), t);
+  }
+  result->Set(String::NewFromUtf8(isolate, "threads"),
+	      Number::New(isolate, stats.threads));
+  result->Set(String::NewFromUtf8(isolate, "running"),
+	      Number::New(isolate, stats.running));
+  result->Set(String::NewFromUtf8(isolate, "completed"),
+	      Number::New(isolate, stats.completed));
+  result->Set(String::NewFromUtf8(isolate, "cancelled"),
+	      Number::New(isolate, stats.cancelled));
+  result->Set(String::NewFromUtf8(isolate, "priorities"), classes);
+  result->Set(String::NewFromUtf8(isolate, "tenants"), tenants);
+  result->Set(String::NewFromUtf8(isolate, "placement"),
+	      String::NewFromUtf8(isolate, policy_name(stats.policy)));
+  result->Set(String::NewFromUtf8(isolate, "nodes"),
+	      node_counts(stats.nodes, isolate));
+  args.GetReturnValue().Set(result);
+}
+
+/*  - - - - - - - - - - - - - --ooOoo-- - - - - - - - - - - -  */
+
+// set_memory_budget(bytes, mode): 0 removes the budget, mode is "queue"
+// (the default) or "fail"
+void memory_set_budget(const FunctionCallbackInfo<Value>& args)
+{
+  Isolate* isolate = args.GetIsolate();
+  memory_accounting::mode policy = memory_accounting::QUEUE;
+
+  if (args.Length() < 1 or not args[0]->IsNumber() or
+      args[0]->NumberValue() < 0) {
+    isolate->ThrowException(Exception::TypeError(
+	String::NewFromUtf8(isolate, "set_memory_budget: bytes expected")));
+    return;
+  }
+  if (args.Length() > 1 and args[1]->IsString()) {
+    std::string name = *String::Utf8Value(args[1]);
+
+    if (name == "fail") {
+      policy = memory_accounting::FAIL;
+    } else if (name != "queue") {
+      isolate->ThrowException(Exception::RangeError(
+	  String::NewFromUtf8(isolate, ("unknown memory mode " +
+					name).c_str())));
+      return;
+    }
+  }
+  memory_accounting::instance().set_budget(
+    static_cast < uint64_t >(args[0]->NumberValue()), policy);
+}
+
+// {experiments: {objects, bytes}, values, snapshots, results, runs,
+//  total, budget, mode, waiting, queued, rejected}
+void memory(const FunctionCallbackInfo<Value>& args)
+{
+  Isolate* isolate = args.GetIsolate();
+  memory_accounting::stats stats;
+  Local < Object > result = Object::New(isolate);
+
+  memory_accounting::instance().get_stats(stats);
+  for (unsigned int i = 0; i < memory_accounting::CATEGORIES; ++i) {
+    memory_accounting::category category =
+      static_cast < memory_accounting::category >(i);
+    Local < Object > c = Object::New(isolate);
+
+    c->Set(String::NewFromUtf8(isolate, "objects"),
+	   Number::New(isolate, stats.objects[i]));
+    c->Set(String::NewFromUtf8(isolate, "bytes"),
+	   Number::New(isolate, stats.bytes[i]));
+    result->Set(String::NewFromUtf8(isolate, category_name(category)), c);
+  }
+  result->Set(String::NewFromUtf8(isolate, "total"),
+	      Number::New(isolate, stats.total));
+  result->Set(String::NewFromUtf8(isolate, "budget"),
+	      Number::New(isolate, stats.budget));
+  result->Set(String::NewFromUtf8(isolate, "mode"),
+	      String::NewFromUtf8(isolate, stats.policy ==
+				  memory_accounting::FAIL ? "fail" : "queue"));
+  result->Set(String::NewFromUtf8(isolate, "waiting"),
+	      Number::New(isolate, stats.waiting));
+  result->Set(String::NewFromUtf8(isolate, "queued"),
+	      Number::New(isolate, stats.queued));
+  result->Set(String::NewFromUtf8(isolate, "rejected"),
+	      Number::New(isolate, stats.rejected));
+  args.GetReturnValue().Set(result);
+}
+
+/*  - - - - - - - - - - - - - --ooOoo-- - - - - - - - - - - -  */
+
+// trace_start({events: n}): n events kept per thread
+void tracing_start(const FunctionCallbackInfo<Value>& args)
+{
+  Isolate* isolate = args.GetIsolate();
+  unsigned int events = 16384;
+
+  if (args.Length() > 0 and args[0]->IsObject()) {
+    Local < Value > n = args[0]->ToObject()->Get(
+      String::NewFromUtf8(isolate, "events"));
+
+    if (n->IsNumber()) {
+      events = n->Uint32Value();
+    }
+  }
+  trace_start(events);
+  trace_thread_name("main");
+}
+
+void tracing_stop(const FunctionCallbackInfo<Value>& args)
+{
+  trace_stop();
+}
+
+// trace_dump() returns the trace as a string, trace_dump(path) writes it
+// and returns the number of events
+void tracing_dump(const FunctionCallbackInfo<Value>& args)
+{
+  Isolate* isolate = args.GetIsolate();
+
+  if (args.Length() > 0 and args[0]->IsString()) {
+    std::string path = *String::Utf8Value(args[0]);
+    std::ofstream file(path.c_str());
+    uint64_t count = trace_dump(file);
+
+    if (not file) {
+      isolate->ThrowException(Exception::Error(
+	  String::NewFromUtf8(isolate, ("cannot write " + path).c_str())));
+      return;
+    }
+    args.GetReturnValue().Set(Number::New(isolate, count));
+  } else {
+    std::ostringstream out;
+
+    trace_dump(out);
+    args.GetReturnValue().Set(String::NewFromUtf8(isolate,
+						  out.str().c_str()));
+  }
+}
+
+/*  - - - - - - - - - - - - - --ooOoo-- - - - - - - - - - - -  */
+
+// Pipelined manager: the simulation threads push finished experiments
+// into a bounded queue while the main thread converts or delivers the
+// previous ones. A full queue blocks the producers (backpressure) so
+// that at most capacity results wait in memory.
+
+typedef std::chrono::steady_clock pipeline_clock;
+
+inline double elapsed_ms(pipeline_clock::time_point start)
+{
+  return std::chrono::duration < double, std::milli >(
+    pipeline_clock::now() - start).count();
+}
+
+struct pipeline_item
+{
+  pipeline_item()
+    : index(0), result(0), block(0), result_bytes(0), trace_id(0), pushed(0)
+  { }
+
+  unsigned int index;
+  value::Map* result;           // untyped mode
+  transfer_block* block;        // typed mode, flattened by the producer
+  uint64_t result_bytes;        // measured by the producer
+  std::string error;
+  uint64_t trace_id;
+  int64_t pushed;               // trace clock, 0 while not tracing
+};
+
+class pipeline_queue
+{
+public:
+  explicit pipeline_queue(unsigned int capacity, unsigned int producers)
+    : _capacity(capacity), _producers(producers), _cancelled(false),
+      _max_depth(0), _depth_sum(0), _pops(0), _blocked(0), _waiting(0)
+  { }
+
+  // false when the consumer gave up, the item is then left to the caller
+  bool push(const pipeline_item& item)
+  {
+    std::unique_lock < std::mutex > lock(_mutex);
+    pipeline_clock::time_point start = pipeline_clock::now();
+
+    _not_full.wait(lock, [this]() {
+	return _cancelled or _items.size() < _capacity; });
+    _blocked += elapsed_ms(start);
+    if (_cancelled) {
+      return false;
+    }
+    _items.push_back(item);
+    _max_depth = std::max(_max_depth, _items.size());
+    _not_empty.notify_one();
+    return true;
+  }
+
+  // false when every producer is done and the queue is empty
+  bool pop(pipeline_item& item)
+  {
+    std::unique_lock < std::mutex > lock(_mutex);
+    pipeline_clock::time_point start = pipeline_clock::now();
+
+    _not_empty.wait(lock, [this]() {
+	return not _items.empty() or _producers == 0; });
+    _waiting += elapsed_ms(start);
+    if (_items.empty()) {
+      return false;
+    }
+    _depth_sum += _items.size();
+    ++_pops;
+    item = _items.front();
+    _items.pop_front();
+    _not_full.notify_one();
+    return true;
+  }
+
+  void producer_done()
+  {
+    std::lock_guard < std::mutex > lock(_mutex);
+
+    --_producers;
+    _not_empty.notify_all();
+  }
+
+  bool cancelled()
+  {
+    std::lock_guard < std::mutex > lock(_mutex);
+
+    return _cancelled;
+  }
+
+  void cancel()
+  {
+    std::lock_guard < std::mutex > lock(_mutex);
+
+    _cancelled = true;
+    _not_full.notify_all();
+  }
+
+  unsigned int capacity() const
+  { return _capacity; }
+
+  size_t max_depth() const
+  { return _max_depth; }
+
+  double mean_depth() const
+  { return _pops ? static_cast < double >(_depth_sum) / _pops : 0.0; }
+
+  double blocked() const
+  { return _blocked; }
+
+  double waiting() const
+  { return _waiting; }
+
+private:
+  std::mutex _mutex;
+  std::condition_variable _not_full;
+  std::condition_variable _not_empty;
+  std::deque < pipeline_item > _items;
+  unsigned int _capacity;
+  unsigned int _producers;
+  bool _cancelled;
+  size_t _max_depth;
+  size_t _depth_sum;
+  size_t _pops;
+  double _blocked;      // producers waiting on a full queue, ms
+  double _waiting;      // consumer waiting on an empty queue, ms
+};
+
+void pipeline_release(pipeline_item& item)
+{
+  delete item.result;
+  delete item.block;
+  item.result = 0;
+  item.block = 0;
+}
+
+struct pipeline_job
+{
+  const vpz::Vpz* vpz;
+  const utils::ModuleManager* modules;
+  run_control control;
+  view_filters filters;
+  bool typed;
+  bool shared;
+  placement where;
+  uint64_t memory;              // estimate of one simulation or result
+  unsigned int size;
+  std::atomic < unsigned int > next;
+};
+
+struct pipeline_worker
+{
+  pipeline_worker() : busy(0), simulations(0), node(0)
+  { }
+
+  double busy;                  // ms spent simulating
+  unsigned int simulations;
+  int node;
+};
+
+// a producer leaves the queue even when it throws, the consumer would
+// wait for it forever
+class pipeline_done
+{
+public:
+  explicit pipeline_done(pipeline_queue& queue) : _queue(queue)
+  { }
+
+  ~pipeline_done()
+  { _queue.producer_done(); }
+
+private:
+  pipeline_done(const pipeline_done&);
+  pipeline_done& operator=(const pipeline_done&);
+
+  pipeline_queue& _queue;
+};
+
+// one simulation job of the scheduler pool: combinations are taken in
+// order from the shared counter. The thread is pinned first, so that
+// its copies of the experiment and its results are allocated on its
+// node.
+void pipeline_produce(pipeline_job& job, pipeline_queue& queue,
+		      unsigned int index, pipeline_worker& worker)
+{
+  std::vector < int > cpus;
+
+  if (not job.where.empty()) {
+    cpus.push_back(job.where.cpu(index));
+  }
+
+  scoped_affinity pinned(cpus);
+  pipeline_done done(queue);
+
+  worker.node = current_node();
+
+  manager::ExperimentGenerator generator(*job.vpz, 0, 1);
+  unsigned int i;
+
+  while (not queue.cancelled() and (i = job.next++) < job.size) {
+    pipeline_clock::time_point start = pipeline_clock::now();
+    pipeline_item item;
+
+    item.index = i;
+    item.trace_id = trace_next_id();
+
+    trace_run traced(item.trace_id);
+
+    try {
+      vpz::Vpz* vpz;
+      std::unique_ptr < value::Map > res;
+      run_control control(job.control);
+
+      {
+	trace_span span("copy");
+
+	vpz = new vpz::Vpz(*job.vpz);
+	generator.get(i, &vpz->project().experiment().conditions());
+      }
+      res.reset(simulate(vpz, *job.modules, control));
+      if (res) {
+	item.result_bytes = value_size(res.get());
+      }
+      if (not res) {
+	item.error = "simulation failed";
+      } else if (job.typed) {
+	trace_span span("convert");
+
+	item.block = new transfer_block();
+	item.block->fill(*res, &job.filters);
+      } else {
+	item.result = res.release();
+      }
+    } catch(const std::exception& e) {
+      pipeline_release(item);
+      item.error = e.what();
+    }
+    worker.busy += elapsed_ms(start);
+    ++worker.simulations;
+    item.pushed = item.trace_id ? trace_now() : 0;
+    if (not queue.push(item)) {
+      pipeline_release(item);
+    }
+  }
+}
+
+// on the way out of run_manager_pipeline, by return or by exception:
+// stops the producers, waits for them since they use the queue and the
+// job, and frees the results left in the queue
+class pipeline_guard
+{
+public:
+  pipeline_guard(pipeline_queue& queue, job_group& workers)
+    : _queue(queue), _workers(workers)
+  { }
+
+  ~pipeline_guard()
+  {
+    pipeline_item item;
+
+    _queue.cancel();
+    _workers.wait();
+    while (_queue.pop(item)) {
+      pipeline_release(item);
+    }
+  }
+
+private:
+  pipeline_guard(const pipeline_guard&);
+  pipeline_guard& operator=(const pipeline_guard&);
+
+  pipeline_queue& _queue;
+  job_group& _workers;
+};
+
+// set while run_manager_pipeline calls each: its producers then hold
+// pool threads, blocked on a full queue, so a call waiting for the pool
+// from the callback would never return
+static bool pipeline_delivering = false;
+
+// throws an Error and returns false if called from each
+static bool check_pipeline_reentry(const char* name, Isolate* isolate)
+{
+  if (pipeline_delivering) {
+    isolate->ThrowException(Exception::Error(
+	String::NewFromUtf8(isolate, (std::string(name) +
+				      ": cannot be called from a pipeline "
+				      "each callback").c_str())));
+    return false;
+  }
+  return true;
+}
+
+/*  - - - - - - - - - - - - - --ooOoo-- - - - - - - - - - - -  */
+
+// raised when the progress callback throws, unwinds the optimizer
+struct calibration_aborted
+{ };
+
+struct calibration_parameter
+{
+  std::string condition;
+  std::string port;
+  double min;
+  double max;
+  double init;
+};
+
+struct calibration_target
+{
+  std::string column;
+  std::vector < double > observed;
+  std::vector < double > times;         // sorted, one per observation
+};
+
+struct calibration_problem
+{
+  const vpz::Vpz* vpz;
+  const utils::ModuleManager* modules;
+  std::vector < calibration_parameter > parameters;
+  std::vector < calibration_target > targets;
+  std::string metric;
+  unsigned int threads;
+  placement where;
+  run_control control;
+};
+
+// error between one simulation result and the observed columns. Each
+// observation is compared with the first simulated row at its time;
+// observations without such a row, and rows where either side is
+// missing (NaN or null), are skipped
+double calibration_error(const calibration_problem& pb, const value::Map& out)
+{
+  double total = 0;
+
+  for (unsigned int k = 0; k < pb.targets.size(); ++k) {
+    const calibration_target& target = pb.targets[k];
+    unsigned int column;
+    const value::Matrix* matrix = find_column(out, target.column, column);
+    unsigned int time = matrix ? matrix->columns() : 0;
+
+    for (unsigned int c = 0; c < time; ++c) {
+      if (matrix->getString(c, 0) == "time") {
+	time = c;
+      }
+    }
+    if (not matrix or time == matrix->columns()) {
+      return std::numeric_limits < double >::infinity();
+    }
+
+    value::ConstVectorView t = matrix->column(time);
+    value::ConstVectorView y = matrix->column(column);
+    unsigned int rows = matrix->rows();
+    unsigned int r = 1;
+    double sum = 0;
+    unsigned int count = 0;
+
+    // both sides in time order
+    for (unsigned int i = 0; i < target.observed.size() and r < rows; ++i) {
+      double at = target.times[i];
+      double tolerance = 1e-9 * std::max(1.0, std::abs(at));
+
+      while (r < rows and not (to_double(t[r]) >= at - tolerance)) {
+	++r;
+      }
+      if (r == rows or to_double(t[r]) > at + tolerance) {
+	continue;
+      }
+
+      double err = to_double(y[r]) - target.observed[i];
+
+      if (not std::isnan(err)) {
+	sum += pb.metric == "mae" ? std::abs(err) : err * err;
+	++count;
+      }
+    }
+    if (count == 0) {
+      return std::numeric_limits < double >::infinity();
+    }
+    if (pb.metric == "sse") {
+      total += sum;
+    } else if (pb.metric == "mae") {
+      total += sum / count;
+    } else {
+      total += std::sqrt(sum / count);
+    }
+  }
+  return total;
+}
+
+// a failed simulation scores infinity, an exception stops the batch and
+// is raised again once the workers are joined
+void calibration_evaluate(const calibration_problem& pb,
+			  const point_list& points,
+			  std::vector < double >& values)
+{
+  std::atomic < unsigned int > next(0);
+  std::mutex failure_mutex;
+  std::string failure;
+  auto worker = [&](unsigned int index) {
+    std::vector < int > cpus;
+    unsigned int i;
+
+    if (not pb.where.empty()) {
+      cpus.push_back(pb.where.cpu(index));
+    }
+
+    // a pool thread, given back its cpus afterwards
+    scoped_affinity pinned(cpus);
+
+    while ((i = next++) < points.size()) {
+      values[i] = std::numeric_limits < double >::infinity();
+
+      trace_run traced(trace_next_id());
+
+      try {
+	vpz::Vpz* vpz;
+
+	{
+	  trace_span span("copy");
+
+	  vpz = new vpz::Vpz(*pb.vpz);
+	  for (unsigned int p = 0; p < pb.parameters.size(); ++p) {
+	    const calibration_parameter& param = pb.parameters[p];
+	    vpz::Condition& cnd(vpz->project().experiment().
+				conditions().get(param.condition));
+
+	    cnd.clearValueOfPort(param.port);
+	    cnd.addValueToPort(param.port, value::Double::create(
+				 param.min + points[i][p] *
+				 (param.max - param.min)));
+	  }
+	}
+
+	run_control control(pb.control);
+	value::Map* res = simulate(vpz, *pb.modules, control);
+
+	if (res) {
+	  values[i] = calibration_error(pb, *res);
+	  delete res;
+	}
+      } catch(const std::exception& e) {
+	std::lock_guard < std::mutex > lock(failure_mutex);
+
+	if (failure.empty()) {
+	  failure = e.what();
+	}
+	next = points.size();
+      }
+    }
+  };
+  unsigned int nbthreads = std::max(1u, std::min < unsigned int >(
+				      pb.threads, points.size()));
+  job_group group;
+
+  for (unsigned int i = 0; i < nbthreads; ++i) {
+    group.run([&worker, i]() { worker(i); });
+  }
+  group.wait();
+  if (not failure.empty()) {
+    throw std::runtime_error("calibrate: " + failure);
+  }
+}
+
+// the options of calibrate and calibrate_async; throws a javascript
+// exception and returns false when they are wrong
+bool parse_calibration(Local < Object > opts, const vpz::Vpz& vpz,
+		       calibration_problem& pb, optimizer_options& options,
+		       std::vector < double >& x0, std::string& algo,
+		       Isolate* isolate)
+{
+  Local < Value > params = opts->Get(String::NewFromUtf8(isolate, "params"));
+  Local < Value > observed = opts->Get(String::NewFromUtf8(isolate,
+							   "observed"));
+  Local < Value > metric = opts->Get(String::NewFromUtf8(isolate, "metric"));
+  Local < Value > algorithm = opts->Get(String::NewFromUtf8(isolate,
+							    "algorithm"));
+  Local < Value > threads = opts->Get(String::NewFromUtf8(isolate, "threads"));
+
+  if (not params->IsArray() or not observed->IsObject()) {
+    isolate->ThrowException(Exception::TypeError(
+	String::NewFromUtf8(isolate,
+			    "calibrate: params and observed expected")));
+    return false;
+  }
+  for (unsigned int i = 0; i < Local < Array >::Cast(params)->Length(); ++i) {
+    Local < Object > p = Local < Array >::Cast(params)->Get(i)->ToObject();
+    calibration_parameter param;
+
+    param.condition = *String::Utf8Value(
+      p->Get(String::NewFromUtf8(isolate, "condition")));
+    param.port = *String::Utf8Value(
+      p->Get(String::NewFromUtf8(isolate, "port")));
+    param.min = p->Get(String::NewFromUtf8(isolate, "min"))->NumberValue();
+    param.max = p->Get(String::NewFromUtf8(isolate, "max"))->NumberValue();
+    param.init = p->Has(String::NewFromUtf8(isolate, "value")) ?
+      p->Get(String::NewFromUtf8(isolate, "value"))->NumberValue() :
+      (param.min + param.max) / 2;
+    if (not (param.max > param.min)) {
+      isolate->ThrowException(Exception::RangeError(
+	  String::NewFromUtf8(isolate, ("calibrate: bad parameter " +
+					param.condition + "." +
+					param.port).c_str())));
+      return false;
+    }
+    if (not vpz.project().experiment().conditions().
+	exist(param.condition) or
+	not vpz.project().experiment().conditions().
+	get(param.condition).conditionvalues().count(param.port)) {
+      isolate->ThrowException(Exception::RangeError(
+	  String::NewFromUtf8(isolate, ("calibrate: unknown port " +
+					param.condition + "." +
+					param.port).c_str())));
+      return false;
+    }
+    pb.parameters.push_back(param);
+    x0.push_back((param.init - param.min) / (param.max - param.min));
+  }
+
+  Local < Array > columns = observed->ToObject()->GetOwnPropertyNames();
+
+  std::vector < calibration_target > read;
+  std::vector < double > times;
+  Local < Value > shared = opts->Get(String::NewFromUtf8(isolate, "times"));
+
+  for (unsigned int i = 0; i < columns->Length(); ++i) {
+    calibration_target target;
+
+    target.column = *String::Utf8Value(columns->Get(i));
+    if (not to_doubles(observed->ToObject()->Get(columns->Get(i)),
+		       target.observed)) {
+      isolate->ThrowException(Exception::TypeError(
+	  String::NewFromUtf8(isolate, ("calibrate: observed column " +
+					target.column +
+					" is not an array").c_str())));
+      return false;
+    }
+    read.push_back(target);
+  }
+  if (not shared->IsUndefined() and not to_doubles(shared, times)) {
+    isolate->ThrowException(Exception::TypeError(
+	String::NewFromUtf8(isolate, "calibrate: times is not an array")));
+    return false;
+  }
+
+  // the observations are matched to the simulated rows by time: the
+  // observed <view>.time column of their view (the longest one, view
+  // names may hold dots), or else times
+  std::set < std::string > time_columns;
+
+  for (unsigned int i = 0; i < read.size(); ++i) {
+    const calibration_target* time = 0;
+
+    for (unsigned int j = 0; j < read.size(); ++j) {
+      const std::string& name = read[j].column;
+      size_t view = name.size() - 4;
+
+      if (j != i and name.size() > 5 and
+	  name.compare(view - 1, 5, ".time") == 0 and
+	  read[i].column.compare(0, view, name, 0, view) == 0 and
+	  (not time or time->column.size() < name.size())) {
+	time = &read[j];
+      }
+    }
+    if (time) {
+      read[i].times = time->observed;
+      time_columns.insert(time->column);
+    } else {
+      read[i].times = times;
+    }
+  }
+  for (unsigned int i = 0; i < read.size(); ++i) {
+    const calibration_target& target = read[i];
+
+    if (time_columns.count(target.column)) {
+      continue;
+    }
+    if (target.times.size() != target.observed.size()) {
+      isolate->ThrowException(Exception::RangeError(
+	  String::NewFromUtf8(isolate, ("calibrate: no observed time for " +
+					target.column).c_str())));
+      return false;
+    }
+    for (unsigned int k = 1; k < target.times.size(); ++k) {
+      if (not (target.times[k] >= target.times[k - 1])) {
+	isolate->ThrowException(Exception::RangeError(
+	    String::NewFromUtf8(isolate, ("calibrate: observed times of " +
+					  target.column +
+					  " are not sorted").c_str())));
+	return false;
+      }
+    }
+    pb.targets.push_back(target);
+  }
+
+  if (not parse_run_control(opts, pb.control, isolate) or
+      not parse_placement(opts->Get(String::NewFromUtf8(isolate,
+							 "placement")),
+			  pb.where, isolate)) {
+    return false;
+  }
+  pb.metric = metric->IsString() ? *String::Utf8Value(metric) : "rmse";
+  if (pb.metric != "rmse" and pb.metric != "mae" and pb.metric != "sse") {
+    isolate->ThrowException(Exception::TypeError(
+	String::NewFromUtf8(isolate, ("calibrate: unknown metric " +
+				      pb.metric).c_str())));
+    return false;
+  }
+  pb.threads = threads->IsNumber() ?
+    static_cast < unsigned int >(threads->NumberValue()) :
+    std::thread::hardware_concurrency();
+  if (opts->Has(String::NewFromUtf8(isolate, "max_iterations"))) {
+    options.max_iterations = opts->Get(String::NewFromUtf8(
+					 isolate, "max_iterations"))->
+      Uint32Value();
+  }
+  if (opts->Has(String::NewFromUtf8(isolate, "max_evaluations"))) {
+    options.max_evaluations = opts->Get(String::NewFromUtf8(
+					  isolate, "max_evaluations"))->
+      Uint32Value();
+  }
+  if (opts->Has(String::NewFromUtf8(isolate, "tolerance"))) {
+    options.tolerance = opts->Get(String::NewFromUtf8(
+				    isolate, "tolerance"))->NumberValue();
+  }
+  if (opts->Has(String::NewFromUtf8(isolate, "seed"))) {
+    options.seed = opts->Get(String::NewFromUtf8(isolate, "seed"))->
+      Uint32Value();
+  }
+  if (opts->Has(String::NewFromUtf8(isolate, "population"))) {
+    options.population = opts->Get(String::NewFromUtf8(
+				     isolate, "population"))->Uint32Value();
+  }
+
+  // without an iteration bound a run whose simulations all fail never
+  // ends, and cmaes needs a parent
+  if (options.max_iterations == 0 or options.population == 1) {
+    isolate->ThrowException(Exception::RangeError(
+	String::NewFromUtf8(isolate, "calibrate: max_iterations must be "
+			    "positive and population at least 2")));
+    return false;
+  }
+
+  algo = algorithm->IsString() ?
+    *String::Utf8Value(algorithm) : "nelder-mead";
+
+  if (algo != "cmaes" and algo != "nelder-mead") {
+    isolate->ThrowException(Exception::RangeError(
+	String::NewFromUtf8(isolate, ("calibrate: unknown algorithm " +
+				      algo).c_str())));
+    return false;
+  }
+  if (pb.parameters.empty() or pb.targets.empty()) {
+    isolate->ThrowException(Exception::TypeError(
+	String::NewFromUtf8(isolate, "calibrate: nothing to calibrate")));
+    return false;
+  }
+
+  return true;
+}
+
+// the progress event of an iteration
+Local < Object > calibration_event(const calibration_problem& pb,
+				   const optimizer_result& current,
+				   Isolate* isolate)
+{
+  Local < Object > event = Object::New(isolate);
+  Local < Array > values = Array::New(isolate);
+
+  for (unsigned int i = 0; i < current.x.size(); ++i) {
+    values->Set(i, Number::New(isolate, pb.parameters[i].min +
+			       current.x[i] * (pb.parameters[i].max -
+					       pb.parameters[i].min)));
+  }
+  event->Set(String::NewFromUtf8(isolate, "iteration"),
+	     Number::New(isolate, current.iterations));
+  event->Set(String::NewFromUtf8(isolate, "evaluations"),
+	     Number::New(isolate, current.evaluations));
+  event->Set(String::NewFromUtf8(isolate, "value"),
+	     Number::New(isolate, current.value));
+  event->Set(String::NewFromUtf8(isolate, "params"), values);
+  return event;
+}
+
+Local < Object > calibration_result(const calibration_problem& pb,
+				    const optimizer_result& best,
+				    Isolate* isolate)
+{
+  Local < Object > retval = Object::New(isolate);
+  Local < Array > values = Array::New(isolate);
+
+  for (unsigned int i = 0; i < best.x.size(); ++i) {
+    Local < Object > param = Object::New(isolate);
+
+    param->Set(String::NewFromUtf8(isolate, "condition"),
+	       String::NewFromUtf8(isolate,
+				   pb.parameters[i].condition.c_str()));
+    param->Set(String::NewFromUtf8(isolate, "port"),
+	       String::NewFromUtf8(isolate, pb.parameters[i].port.c_str()));
+    param->Set(String::NewFromUtf8(isolate, "value"),
+	       Number::New(isolate, pb.parameters[i].min + best.x[i] *
+			   (pb.parameters[i].max - pb.parameters[i].min)));
+    values->Set(i, param);
+  }
+  retval->Set(String::NewFromUtf8(isolate, "params"), values);
+  retval->Set(String::NewFromUtf8(isolate, "value"),
+	      Number::New(isolate, best.value));
+  retval->Set(String::NewFromUtf8(isolate, "iterations"),
+	      Number::New(isolate, best.iterations));
+  retval->Set(String::NewFromUtf8(isolate, "evaluations"),
+	      Number::New(isolate, best.evaluations));
+  retval->Set(String::NewFromUtf8(isolate, "converged"),
+	      Boolean::New(isolate, best.converged));
+  return retval;
+}
+
+// a calibrate_async call: the optimizer runs on a thread of its own, the
+// simulations on the pool, and the progress events and the result are
+// handed to the main thread through a uv_async handle
+struct calibration_job
+{
+  calibration_job()
+    : vpz(0), memory(0), reporting(false), done(false), aborted(false)
+  { }
+
+  ~calibration_job()
+  {
+    delete vpz;
+    exception.Reset();
+    self.Reset();
+    progress.Reset();
+    callback.Reset();
+  }
+
+  calibration_problem pb;
+  optimizer_options options;
+  std::vector < double > x0;
+  std::string algo;
+  vpz::Vpz* vpz;                // the base copy
+  utils::ModuleManager modules;
+  uint64_t memory;              // reserved while the optimizer runs
+  bool reporting;               // a progress callback was given
+  std::thread thread;
+  uv_async_t async;
+
+  std::mutex mutex;
+  std::deque < optimizer_result > events;
+  bool done;
+  optimizer_result best;
+  std::string error;
+
+  std::atomic < bool > aborted; // progress threw, the optimizer stops
+  Persistent < Value > exception;
+  Persistent < Object > self;
+  Persistent < Function > progress;
+  Persistent < Function > callback;
+};
+
+// the optimizer thread
+void calibration_run(calibration_job* job)
+{
+  try {
+    // not a pool thread: it may wait for memory
+    memory_reservation reserved(job->memory, true, &job->aborted);
+    batch_objective f = [job](const point_list& points,
+			      std::vector < double >& values)
+      { calibration_evaluate(job->pb, points, values); };
+    optimizer_progress report = [job](const optimizer_result& current) {
+      if (job->aborted) {
+	throw calibration_aborted();
+      }
+      if (job->reporting) {
+	{
+	  std::lock_guard < std::mutex > lock(job->mutex);
+
+	  job->events.push_back(current);
+	}
+	uv_async_send(&job->async);
+      }
+    };
+    optimizer_result best = job->algo == "cmaes" ?
+      cmaes(job->x0, f, job->options, report) :
+      nelder_mead(job->x0, f, job->options, report);
+    std::lock_guard < std::mutex > lock(job->mutex);
+
+    job->best = best;
+  } catch(const calibration_aborted& e) {
+  } catch(const std::exception& e) {
+    std::lock_guard < std::mutex > lock(job->mutex);
+
+    job->error = e.what();
+  }
+  {
+    std::lock_guard < std::mutex > lock(job->mutex);
+
+    job->done = true;
+  }
+  uv_async_send(&job->async);
+}
+
+void calibration_close(uv_handle_t* handle)
+{
+  delete static_cast < calibration_job* >(handle->data);
+}
+
+// main thread: progress events, then the callback once the optimizer
+// thread is done
+void calibration_deliver(uv_async_t* handle)
+{
+  calibration_job* job = static_cast < calibration_job* >(handle->data);
+  Isolate* isolate = Isolate::GetCurrent();
+  HandleScope scope(isolate);
+  std::deque < optimizer_result > events;
+  bool done;
+
+  {
+    std::lock_guard < std::mutex > lock(job->mutex);
+
+    events.swap(job->events);
+    done = job->done;
+  }
+  for (unsigned int i = 0; i < events.size() and not job->aborted; ++i) {
+    TryCatch try_catch(isolate);
+    Local < Value > argv[1] = { calibration_event(job->pb, events[i],
+						  isolate) };
+
+    Local < Function >::New(isolate, job->progress)->Call(
+      isolate->GetCurrentContext()->Global(), 1, argv);
+    if (try_catch.HasCaught()) {
+      job->exception.Reset(isolate, try_catch.Exception());
+      job->aborted = true;
+    }
+  }
+  if (not done) {
+    return;
+  }
+  job->thread.join();
+
+  Local < Value > argv[2];
+
+  if (job->aborted) {
+    argv[0] = Local < Value >::New(isolate, job->exception);
+    argv[1] = Null(isolate);
+  } else if (not job->error.empty()) {
+    argv[0] = Exception::Error(String::NewFromUtf8(isolate,
+						   job->error.c_str()));
+    argv[1] = Null(isolate);
+  } else {
+    argv[0] = Null(isolate);
+    argv[1] = calibration_result(job->pb, job->best, isolate);
+  }
+
+  Local < Object > self = Local < Object >::New(isolate, job->self);
+  Local < Function > callback = Local < Function >::New(isolate,
+							 job->callback);
+
+  uv_close(reinterpret_cast < uv_handle_t* >(&job->async), calibration_close);
+  node::MakeCallback(isolate, self, callback, 2, argv);
+}
+
+/*  - - - - - - - - - - - - - --ooOoo-- - - - - - - - - - - -  */
+
+Persistent<Function> ValueWrapper::constructor;
+
+void ValueWrapper::Init(Handle<Object> exports)
+{
+  Isolate* isolate = exports->GetIsolate();
+  Local<FunctionTemplate> tpl = FunctionTemplate::New(isolate, New);
+
+  tpl->SetClassName(String::NewFromUtf8(isolate, "Value"));
+  tpl->InstanceTemplate()->SetInternalFieldCount(1);
+
+  // Prototype
+  NODE_SET_PROTOTYPE_METHOD(tpl, "get_type", get_type);
+
+  constructor.Reset(isolate, tpl->GetFunction());
+  exports->Set(String::NewFromUtf8(isolate, "Value"),
+	       tpl->GetFunction());
+}
+
+// {shape: [width, height], data: Float64Array}, the layout of a table
+// returned by convert_value
+bool is_table(Local < Object > v)
+{
+  Isolate* isolate = v8::Isolate::GetCurrent();
+  Local < Value > shape = v->Get(String::NewFromUtf8(isolate, "shape"));
+  Local < Value > data = v->Get(String::NewFromUtf8(isolate, "data"));
+
+  return shape->IsArray() and Local < Array >::Cast(shape)->Length() == 2 and
+    data->IsFloat64Array() and
+    Local < Float64Array >::Cast(data)->Length() ==
+    Local < Array >::Cast(shape)->Get(0)->Uint32Value() *
+    Local < Array >::Cast(shape)->Get(1)->Uint32Value();
+}
+
+value::Value* convert_to_vle(Local < Value > v)
+{
+    if (v->IsNumber()) {
+      Local < Number > arg = v->ToNumber();
+      double value = arg->Value();
+
       if (value == static_cast < int >(value)) {
 	return value::Integer::create(static_cast < int >(value));
       } else {
@@ -363,45 +2871,405 @@ value::Value* convert_to_vle(Local < Value > v)
       Local < Boolean > arg = v->ToBoolean();
       bool value = arg->Value();
 
-      return value::Boolean::create(value);
-    } else if (v->IsArray()) {
-      Local < Array > arg = Local < Array >::Cast(v);
-      value::Set* result = value::Set::create();
+      return value::Boolean::create(value);
+    } else if (v->IsFloat64Array()) {
+      Local < Float64Array > arg = Local < Float64Array >::Cast(v);
+      value::Tuple* result = new value::Tuple(arg->Length());
+
+      arg->CopyContents(result->value().data(),
+			arg->Length() * sizeof(double));
+      return result;
+    } else if (v->IsObject() and is_table(Local < Object >::Cast(v))) {
+      Local < Object > arg = Local < Object >::Cast(v);
+      Local < Array > shape = Local < Array >::Cast(
+	arg->Get(String::NewFromUtf8(v8::Isolate::GetCurrent(), "shape")));
+      Local < Float64Array > data = Local < Float64Array >::Cast(
+	arg->Get(String::NewFromUtf8(v8::Isolate::GetCurrent(), "data")));
+      value::Table* result = new value::Table(shape->Get(0)->Uint32Value(),
+					      shape->Get(1)->Uint32Value());
+
+      data->CopyContents(result->value().data(),
+			 result->width() * result->height() * sizeof(double));
+      return result;
+    } else if (v->IsArray()) {
+      Local < Array > arg = Local < Array >::Cast(v);
+      value::Set* result = value::Set::create();
+
+      for (unsigned int i = 0; i < arg->Length(); ++i) {
+	result->add(convert_to_vle(arg->Get(i)));
+      }
+      return result;
+    } else if (v->IsObject()) {
+      Local < Object > arg = Local < Object >::Cast(v);
+      Local < Array > properties = arg->GetOwnPropertyNames();
+      value::Map* result = value::Map::create();
+
+      for (unsigned int i = 0; i < properties->Length(); ++i) {
+	Local < Value > key = properties->Get(i);
+
+	result->add(*String::Utf8Value(key),
+		    convert_to_vle(arg->Get(key)));
+      }
+      return result;
+    } else {
+      return 0;
+    }
+}
+
+void ValueWrapper::New(const FunctionCallbackInfo<Value>& jsargs)
+{
+//  Isolate* isolate = jsargs.GetIsolate();
+
+  if (jsargs.IsConstructCall()) {
+    ValueWrapper* obj = new ValueWrapper();
+
+    obj->_value = convert_to_vle(jsargs[0]);
+    obj->_memory.update(value_size(obj->_value));
+    obj->Wrap(jsargs.This());
+    jsargs.GetReturnValue().Set(jsargs.This());
+  } else {
+
+  }
+}
+
+/*  - - - - - - - - - - - - - --ooOoo-- - - - - - - - - - - -  */
+
+Persistent<Function> ColumnFileWrapper::constructor;
+Persistent<FunctionTemplate> ColumnFileWrapper::tpl;
+
+void ColumnFileWrapper::Init(Handle<Object> exports)
+{
+  Isolate* isolate = exports->GetIsolate();
+  Local<FunctionTemplate> t = FunctionTemplate::New(isolate, New);
+
+  t->SetClassName(String::NewFromUtf8(isolate, "ColumnFile"));
+  t->InstanceTemplate()->SetInternalFieldCount(1);
+
+  // Prototype
+  NODE_SET_PROTOTYPE_METHOD(t, "columns", columns);
+  NODE_SET_PROTOTYPE_METHOD(t, "rows", rows);
+  NODE_SET_PROTOTYPE_METHOD(t, "column", column);
+  NODE_SET_PROTOTYPE_METHOD(t, "nulls", nulls);
+
+  tpl.Reset(isolate, t);
+  constructor.Reset(isolate, t->GetFunction());
+  exports->Set(String::NewFromUtf8(isolate, "ColumnFile"),
+	       t->GetFunction());
+}
+
+bool ColumnFileWrapper::HasInstance(Local < Value > value, Isolate* isolate)
+{
+  Local < FunctionTemplate > t = Local < FunctionTemplate >::New(isolate, tpl);
+
+  return value->IsObject() and t->HasInstance(value);
+}
+
+Local < Object > ColumnFileWrapper::NewInstance(column_file* file,
+						Isolate* isolate)
+{
+  EscapableHandleScope scope(isolate);
+  Local < Function > cons = Local < Function >::New(isolate, constructor);
+  Local < Object > instance = cons->NewInstance();
+
+  ObjectWrap::Unwrap<ColumnFileWrapper>(instance)->_file = file;
+  return scope.Escape(instance);
+}
+
+void ColumnFileWrapper::New(const FunctionCallbackInfo<Value>& jsargs)
+{
+  Isolate* isolate = jsargs.GetIsolate();
+
+  if (jsargs.IsConstructCall()) {
+    ColumnFileWrapper* obj = new ColumnFileWrapper();
+
+    if (jsargs.Length() > 0) {
+      std::string path = *String::Utf8Value(jsargs[0]->ToString());
+
+      try {
+	obj->_file = new column_file(path);
+      } catch(const std::exception& e) {
+	delete obj;
+	isolate->ThrowException(Exception::Error(
+	    String::NewFromUtf8(isolate, e.what())));
+	return;
+      }
+    }
+    obj->Wrap(jsargs.This());
+    jsargs.GetReturnValue().Set(jsargs.This());
+  } else {
+
+  }
+}
+
+void ColumnFileWrapper::columns(const FunctionCallbackInfo<Value>& args)
+{
+  Isolate* isolate = args.GetIsolate();
+  ColumnFileWrapper* obj = ObjectWrap::Unwrap<ColumnFileWrapper>(args.Holder());
+  Local < Array > result = Array::New(isolate);
+
+  if (obj->_file) {
+    for (unsigned int i = 0; i < obj->_file->columns().size(); ++i) {
+      result->Set(i, String::NewFromUtf8(
+		    isolate, obj->_file->columns()[i].name.c_str()));
+    }
+  }
+  args.GetReturnValue().Set(result);
+}
+
+void ColumnFileWrapper::rows(const FunctionCallbackInfo<Value>& args)
+{
+  if (args.Length() > 0) {
+    Isolate* isolate = args.GetIsolate();
+    ColumnFileWrapper* obj =
+      ObjectWrap::Unwrap<ColumnFileWrapper>(args.Holder());
+    std::string name = *String::Utf8Value(args[0]->ToString());
+    int index = obj->_file ? obj->_file->find(name) : -1;
+
+    if (index < 0) {
+      args.GetReturnValue().Set(Null(isolate));
+    } else {
+      args.GetReturnValue().Set(Number::New(
+				  isolate, obj->_file->columns()[index].rows));
+    }
+  }
+}
+
+// the array buffers point into the mapping, they keep a reference on the
+// wrapper so that the file is not unmapped while they are reachable
+void ColumnFileWrapper::column(const FunctionCallbackInfo<Value>& args)
+{
+  if (args.Length() > 0) {
+    Isolate* isolate = args.GetIsolate();
+    ColumnFileWrapper* obj =
+      ObjectWrap::Unwrap<ColumnFileWrapper>(args.Holder());
+    std::string name = *String::Utf8Value(args[0]->ToString());
+    int index = obj->_file ? obj->_file->find(name) : -1;
+
+    if (index < 0) {
+      args.GetReturnValue().Set(Null(isolate));
+    } else {
+      const column_file::entry& e = obj->_file->columns()[index];
+      Local < ArrayBuffer > buffer = ArrayBuffer::New(
+	isolate, obj->_file->data(e), e.rows * sizeof(double));
+
+      buffer->DefineOwnProperty(isolate->GetCurrentContext(),
+				String::NewFromUtf8(isolate, "file"),
+				args.Holder(), DontEnum).FromMaybe(false);
+      args.GetReturnValue().Set(Float64Array::New(buffer, 0, e.rows));
+    }
+  }
+}
+
+void ColumnFileWrapper::nulls(const FunctionCallbackInfo<Value>& args)
+{
+  if (args.Length() > 0) {
+    Isolate* isolate = args.GetIsolate();
+    ColumnFileWrapper* obj =
+      ObjectWrap::Unwrap<ColumnFileWrapper>(args.Holder());
+    std::string name = *String::Utf8Value(args[0]->ToString());
+    int index = obj->_file ? obj->_file->find(name) : -1;
+
+    if (index < 0 or not obj->_file->columns()[index].nulls) {
+      args.GetReturnValue().Set(Null(isolate));
+    } else {
+      const column_file::entry& e = obj->_file->columns()[index];
+      Local < ArrayBuffer > buffer = ArrayBuffer::New(
+	isolate, obj->_file->nulls(e), (e.rows + 7) / 8);
+
+      buffer->DefineOwnProperty(isolate->GetCurrentContext(),
+				String::NewFromUtf8(isolate, "file"),
+				args.Holder(), DontEnum).FromMaybe(false);
+      args.GetReturnValue().Set(Uint8Array::New(buffer, 0, (e.rows + 7) / 8));
+    }
+  }
+}
+
+/*  - - - - - - - - - - - - - --ooOoo-- - - - - - - - - - - -  */
+
+Persistent<Function> CompressedResultWrapper::constructor;
+Persistent<FunctionTemplate> CompressedResultWrapper::tpl;
+
+void CompressedResultWrapper::Init(Handle<Object> exports)
+{
+  Isolate* isolate = exports->GetIsolate();
+  Local<FunctionTemplate> t = FunctionTemplate::New(isolate, New);
+
+  t->SetClassName(String::NewFromUtf8(isolate, "CompressedResult"));
+  t->InstanceTemplate()->SetInternalFieldCount(1);
+
+  // Prototype
+  NODE_SET_PROTOTYPE_METHOD(t, "columns", columns);
+  NODE_SET_PROTOTYPE_METHOD(t, "rows", rows);
+  NODE_SET_PROTOTYPE_METHOD(t, "column", column);
+  NODE_SET_PROTOTYPE_METHOD(t, "nulls", nulls);
+  NODE_SET_PROTOTYPE_METHOD(t, "info", info);
+
+  // only created by Vle.run, not exported
+  tpl.Reset(isolate, t);
+  constructor.Reset(isolate, t->GetFunction());
+}
+
+Local < Object > CompressedResultWrapper::NewInstance(column_list* columns,
+						      Isolate* isolate)
+{
+  EscapableHandleScope scope(isolate);
+  Local < Function > cons = Local < Function >::New(isolate, constructor);
+  Local < Object > instance = cons->NewInstance();
+
+  CompressedResultWrapper* obj =
+    ObjectWrap::Unwrap<CompressedResultWrapper>(instance);
 
-      for (unsigned int i = 0; i < arg->Length(); ++i) {
-	result->add(convert_to_vle(arg->Get(i)));
-      }
-      return result;
-    } else if (v->IsObject()) {
-      Local < Object > arg = Local < Object >::Cast(v);
-      Local < Array > properties = arg->GetOwnPropertyNames();
-      value::Map* result = value::Map::create();
+  obj->_columns = columns;
+  obj->_memory.update(columns_size(*columns));
+  return scope.Escape(instance);
+}
 
-      for (unsigned int i = 0; i < properties->Length(); ++i) {
-	Local < Value > key = properties->Get(i);
+bool CompressedResultWrapper::HasInstance(Local < Value > value,
+					  Isolate* isolate)
+{
+  Local < FunctionTemplate > t = Local < FunctionTemplate >::New(isolate, tpl);
 
-	result->add(*String::Utf8Value(key),
-		    convert_to_vle(arg->Get(key)));
+  return value->IsObject() and t->HasInstance(value);
+}
+
+int CompressedResultWrapper::find(const std::string& name) const
+{
+  if (_columns) {
+    for (unsigned int i = 0; i < _columns->size(); ++i) {
+      if ((*_columns)[i].name == name) {
+	return i;
       }
-      return result;
-    } else {
-      return 0;
     }
+  }
+  return -1;
 }
 
-void ValueWrapper::New(const FunctionCallbackInfo<Value>& jsargs)
+void CompressedResultWrapper::New(const FunctionCallbackInfo<Value>& jsargs)
 {
-//  Isolate* isolate = jsargs.GetIsolate();
-
   if (jsargs.IsConstructCall()) {
-    ValueWrapper* obj = new ValueWrapper();
+    CompressedResultWrapper* obj = new CompressedResultWrapper();
 
-    obj->_value = convert_to_vle(jsargs[0]);
     obj->Wrap(jsargs.This());
     jsargs.GetReturnValue().Set(jsargs.This());
-  } else {
+  }
+}
+
+void CompressedResultWrapper::columns(const FunctionCallbackInfo<Value>& args)
+{
+  Isolate* isolate = args.GetIsolate();
+  CompressedResultWrapper* obj =
+    ObjectWrap::Unwrap<CompressedResultWrapper>(args.Holder());
+  Local < Array > result = Array::New(isolate);
+
+  if (obj->_columns) {
+    for (unsigned int i = 0; i < obj->_columns->size(); ++i) {
+      result->Set(i, key((*obj->_columns)[i].name, isolate));
+    }
+  }
+  args.GetReturnValue().Set(result);
+}
+
+void CompressedResultWrapper::rows(const FunctionCallbackInfo<Value>& args)
+{
+  if (args.Length() > 0) {
+    Isolate* isolate = args.GetIsolate();
+    CompressedResultWrapper* obj =
+      ObjectWrap::Unwrap<CompressedResultWrapper>(args.Holder());
+    int index = obj->find(*String::Utf8Value(args[0]->ToString()));
+
+    if (index < 0) {
+      args.GetReturnValue().Set(Null(isolate));
+    } else {
+      args.GetReturnValue().Set(Number::New(
+				  isolate, (*obj->_columns)[index].rows));
+    }
+  }
+}
+
+// decoded on each call straight into the backing store of a new
+// Float64Array
+void CompressedResultWrapper::column(const FunctionCallbackInfo<Value>& args)
+{
+  if (args.Length() > 0) {
+    Isolate* isolate = args.GetIsolate();
+    CompressedResultWrapper* obj =
+      ObjectWrap::Unwrap<CompressedResultWrapper>(args.Holder());
+    int index = obj->find(*String::Utf8Value(args[0]->ToString()));
+
+    if (index < 0) {
+      args.GetReturnValue().Set(Null(isolate));
+      return;
+    }
+
+    const compressed_column& col = (*obj->_columns)[index];
+    Local < ArrayBuffer > buffer = ArrayBuffer::New(isolate,
+						    col.rows * sizeof(double));
+
+    try {
+      decompress_column(col, static_cast < double* >(
+			  buffer->GetContents().Data()));
+    } catch(const std::exception& e) {
+      isolate->ThrowException(Exception::Error(
+	  String::NewFromUtf8(isolate, e.what())));
+      return;
+    }
+    args.GetReturnValue().Set(Float64Array::New(buffer, 0, col.rows));
+  }
+}
+
+void CompressedResultWrapper::nulls(const FunctionCallbackInfo<Value>& args)
+{
+  if (args.Length() > 0) {
+    Isolate* isolate = args.GetIsolate();
+    CompressedResultWrapper* obj =
+      ObjectWrap::Unwrap<CompressedResultWrapper>(args.Holder());
+    int index = obj->find(*String::Utf8Value(args[0]->ToString()));
 
+    if (index < 0 or (*obj->_columns)[index].nulls.empty()) {
+      args.GetReturnValue().Set(Null(isolate));
+    } else {
+      const std::vector < uint8_t >& bitmap = (*obj->_columns)[index].nulls;
+      Local < ArrayBuffer > buffer = ArrayBuffer::New(isolate, bitmap.size());
+
+      std::memcpy(buffer->GetContents().Data(), bitmap.data(), bitmap.size());
+      args.GetReturnValue().Set(Uint8Array::New(buffer, 0, bitmap.size()));
+    }
+  }
+}
+
+void CompressedResultWrapper::info(const FunctionCallbackInfo<Value>& args)
+{
+  Isolate* isolate = args.GetIsolate();
+  CompressedResultWrapper* obj =
+    ObjectWrap::Unwrap<CompressedResultWrapper>(args.Holder());
+  Local < Object > result = Object::New(isolate);
+  size_t raw = 0;
+  size_t size = 0;
+
+  if (obj->_columns) {
+    for (unsigned int i = 0; i < obj->_columns->size(); ++i) {
+      const compressed_column& col = (*obj->_columns)[i];
+      Local < Object > c = Object::New(isolate);
+
+      c->Set(String::NewFromUtf8(isolate, "encoding"),
+	     String::NewFromUtf8(isolate, encoding_name(col.encoding)));
+      c->Set(String::NewFromUtf8(isolate, "rows"),
+	     Number::New(isolate, col.rows));
+      c->Set(String::NewFromUtf8(isolate, "bytes"),
+	     Number::New(isolate, col.size()));
+      c->Set(String::NewFromUtf8(isolate, "ratio"),
+	     Number::New(isolate, col.ratio()));
+      result->Set(key(col.name, isolate), c);
+      raw += col.rows * sizeof(double);
+      size += col.size();
+    }
   }
+  result->DefineOwnProperty(isolate->GetCurrentContext(),
+			    String::NewFromUtf8(isolate, "ratio"),
+			    Number::New(isolate, size ? raw /
+					static_cast < double >(size) : 1.0),
+			    DontEnum).FromMaybe(false);
+  args.GetReturnValue().Set(result);
 }
 
 /*  - - - - - - - - - - - - - --ooOoo-- - - - - - - - - - - -  */
@@ -424,8 +3292,14 @@ void VleWrapper::Init(Handle<Object> exports)
   NODE_SET_PROTOTYPE_METHOD(tpl, "get_seed", experiment_get_seed);
   NODE_SET_PROTOTYPE_METHOD(tpl, "set_seed", experiment_set_seed);
   NODE_SET_PROTOTYPE_METHOD(tpl, "run", run);
+  NODE_SET_PROTOTYPE_METHOD(tpl, "run_async", run_async);
+  NODE_SET_PROTOTYPE_METHOD(tpl, "submit", submit);
   NODE_SET_PROTOTYPE_METHOD(tpl, "run_manager", run_manager);
   NODE_SET_PROTOTYPE_METHOD(tpl, "run_manager_thread", run_manager_thread);
+  NODE_SET_PROTOTYPE_METHOD(tpl, "run_manager_pipeline",
+			    run_manager_pipeline);
+  NODE_SET_PROTOTYPE_METHOD(tpl, "calibrate", calibrate);
+  NODE_SET_PROTOTYPE_METHOD(tpl, "calibrate_async", calibrate_async);
   NODE_SET_PROTOTYPE_METHOD(tpl, "condition_list", condition_list);
   NODE_SET_PROTOTYPE_METHOD(tpl, "condition_show", condition_show);
   NODE_SET_PROTOTYPE_METHOD(tpl, "condition_create", condition_create);
@@ -449,17 +3323,44 @@ void VleWrapper::Init(Handle<Object> exports)
 			    condition_delete_value);
   NODE_SET_PROTOTYPE_METHOD(tpl, "output_set_plugin", output_set_plugin);
   NODE_SET_PROTOTYPE_METHOD(tpl, "outputs_list", outputs_list);
+  NODE_SET_PROTOTYPE_METHOD(tpl, "save_snapshot", save_snapshot);
+  NODE_SET_PROTOTYPE_METHOD(tpl, "snapshot", snapshot);
+  NODE_SET_PROTOTYPE_METHOD(tpl, "restore", restore);
+  NODE_SET_PROTOTYPE_METHOD(tpl, "clone", clone);
 
-  constructor.Reset(isolate, tpl->GetFunction());
-  exports->Set(String::NewFromUtf8(isolate, "Vle"),
-	       tpl->GetFunction());
+  Local < Function > cons = tpl->GetFunction();
+
+  cons->Set(String::NewFromUtf8(isolate, "from_snapshot"),
+	    FunctionTemplate::New(isolate, from_snapshot)->GetFunction());
+  constructor.Reset(isolate, cons);
+  exports->Set(String::NewFromUtf8(isolate, "Vle"), cons);
+}
+
+Local < Object > VleWrapper::NewInstance(vpz::Vpz* vpz, Isolate* isolate)
+{
+  EscapableHandleScope scope(isolate);
+  Local < Function > cons = Local < Function >::New(isolate, constructor);
+  Local < Object > instance = cons->NewInstance();
+
+  VleWrapper* obj = ObjectWrap::Unwrap<VleWrapper>(instance);
+
+  obj->_vpz = vpz;
+  obj->_memory.update(vpz ? vpz_size(*vpz) : 0);
+  obj->_sized = obj->_epoch;
+  return scope.Escape(instance);
 }
 
 void VleWrapper::New(const FunctionCallbackInfo<Value>& jsargs)
 {
 //  Isolate* isolate = jsargs.GetIsolate();
 
-  if (jsargs.IsConstructCall()) {
+  if (jsargs.IsConstructCall() and jsargs.Length() == 0) {
+    // empty experiment, filled by NewInstance
+    VleWrapper* obj = new VleWrapper(static_cast < vpz::Vpz* >(0));
+
+    obj->Wrap(jsargs.This());
+    jsargs.GetReturnValue().Set(jsargs.This());
+  } else if (jsargs.IsConstructCall()) {
     Local < String > arg0 = jsargs[0]->ToString();
     Local < String > arg1 = jsargs[1]->ToString();
     std::string pkgname = *String::Utf8Value(arg0);
@@ -568,149 +3469,738 @@ void VleWrapper::experiment_get_duration(const FunctionCallbackInfo<Value>&
 
 void VleWrapper::experiment_set_seed(const FunctionCallbackInfo<Value>& args)
 {
-  //TODO
+  if (args.Length() > 0) {
+    VleWrapper* obj = ObjectWrap::Unwrap<VleWrapper>(args.Holder());
+    Local < Number > arg0 = args[0]->ToNumber();
+
+    obj->_vpz->project().experiment().setSeed(
+      static_cast < uint32_t >(arg0->Value()));
+  }
 }
 
 void VleWrapper::experiment_get_seed(const FunctionCallbackInfo<Value>& args)
 {
-  // TODO
+  Isolate* isolate = args.GetIsolate();
+  VleWrapper* obj = ObjectWrap::Unwrap<VleWrapper>(args.Holder());
+
+  args.GetReturnValue().Set(Number::New(isolate,
+					obj->_vpz->project().experiment().
+					seed()));
 }
 
 void VleWrapper::run(const FunctionCallbackInfo<Value>& args)
 {
   Isolate* isolate = args.GetIsolate();
 
-  VleWrapper* obj = ObjectWrap::Unwrap<VleWrapper>(args.Holder());
-  value::Map* res = NULL;
+  VleWrapper* obj = ObjectWrap::Unwrap<VleWrapper>(args.Holder());
+  value::Map* res = NULL;
+  run_control control;
+  view_filters filters;
+  std::string file;
+  bool compress = false;
+  bool shared = false;
+
+  if (args.Length() > 0 and args[0]->IsObject() and
+      (not parse_run_control(args[0]->ToObject(), control, isolate) or
+       not parse_view_filters(args[0]->ToObject(), filters, isolate))) {
+    return;
+  }
+  if (args.Length() > 0 and args[0]->IsObject()) {
+    Local < Value > path = args[0]->ToObject()->Get(
+      String::NewFromUtf8(isolate, "file"));
+
+    if (path->IsString()) {
+      file = *String::Utf8Value(path);
+    }
+    compress = args[0]->ToObject()->Get(
+      String::NewFromUtf8(isolate, "compress"))->BooleanValue();
+    shared = args[0]->ToObject()->Get(
+      String::NewFromUtf8(isolate, "shared"))->BooleanValue();
+  }
+
+  memory_reservation reserved;
+
+  if (not reserve_run(reserved, obj->run_estimate(), isolate)) {
+    return;
+  }
+
+  try {
+    utils::ModuleManager man;
+    trace_run traced(trace_next_id());
+    std::unique_ptr < scratch_directory > scratch;
+    std::vector < csv_output > files;
+    vpz::Vpz* vpz;
+
+    {
+      trace_span span("copy");
+
+      configure_storage(*obj->_vpz);
+      vpz = new vpz::Vpz(*obj->_vpz);
+      apply_view_filters(*vpz, filters);
+      if (not file.empty()) {
+	scratch.reset(new scratch_directory(file));
+	configure_file_outputs(*vpz, *scratch, files);
+      }
+    }
+    res = simulate(vpz, man, control);
+
+    // without storage plugins there may be no result map, a failed run
+    // leaves no csv file
+    if (res == NULL and file.empty()) {
+      args.GetReturnValue().Set(Null(isolate));
+    } else {
+      Local < Object > retval;
+      trace_span span("convert");
+
+      obj->record_result(value_size(res));
+
+      if (compress) {
+	std::unique_ptr < value::Map > out(res);
+	std::unique_ptr < CompressedResultWrapper::column_list > columns(
+	  new CompressedResultWrapper::column_list());
+	transfer_block block;
+
+	block.fill(*out, &filters);
+	out.reset();
+	compress_result(block, *columns);
+	retval = CompressedResultWrapper::NewInstance(columns.release(),
+						      isolate);
+      } else if (shared) {
+	std::unique_ptr < value::Map > out(res);
+	transfer_block block;
+
+	block.fill(*out, &filters);
+	out.reset();
+	retval = wrap_shared(block, isolate);
+      } else if (file.empty()) {
+	retval = Object::New(isolate);
+	convert(*res, retval, isolate, &filters);
+	delete res;
+      } else {
+	delete res;
+	write_column_file(file, files, &filters);
+	retval = ColumnFileWrapper::NewInstance(new column_file(file), isolate);
+      }
+      set_stop_status(retval, control, isolate);
+      args.GetReturnValue().Set(retval);
+    }
+  } catch(const std::exception& e) {
+    args.GetReturnValue().Set(Null(isolate));
+  }
+}
+
+void VleWrapper::run_async(const FunctionCallbackInfo<Value>& args)
+{
+  Isolate* isolate = args.GetIsolate();
+  VleWrapper* obj = ObjectWrap::Unwrap<VleWrapper>(args.Holder());
+  Local < Value > callback = args[args.Length() > 0 ? args.Length() - 1 : 0];
+
+  if (args.Length() == 0 or not callback->IsFunction()) {
+    isolate->ThrowException(Exception::TypeError(
+	String::NewFromUtf8(isolate, "run_async expects a callback")));
+    return;
+  }
+
+  std::unique_ptr < async_run > job(new async_run());
+
+  if (args.Length() > 1 and args[0]->IsObject() and
+      (not parse_run_control(args[0]->ToObject(), job->control, isolate) or
+       not parse_view_filters(args[0]->ToObject(), job->filters, isolate))) {
+    return;
+  }
+  if (args.Length() > 1 and args[0]->IsObject()) {
+    job->shared = args[0]->ToObject()->Get(
+      String::NewFromUtf8(isolate, "shared"))->BooleanValue();
+  }
+
+  // the copy is made here, later changes of the experiment do not
+  // affect the running job
+  try {
+    job->trace_id = trace_next_id();
+
+    trace_run traced(job->trace_id);
+    trace_span span("copy");
+
+    configure_storage(*obj->_vpz);
+    job->vpz = new vpz::Vpz(*obj->_vpz);
+    apply_view_filters(*job->vpz, job->filters);
+    job->memory = obj->run_estimate();
+    job->queued = job->trace_id ? trace_now() : 0;
+  } catch(const std::exception& e) {
+    isolate->ThrowException(Exception::Error(
+	String::NewFromUtf8(isolate, e.what())));
+    return;
+  }
+  job->self.Reset(isolate, args.Holder());
+  job->callback.Reset(isolate, Local < Function >::Cast(callback));
+
+  // a normal job of no tenant; without an id it cannot be cancelled and
+  // keeps the manager's run
+  async_run* run = job.release();
+  scheduler_bridge& bridge = scheduler_bridge::get();
+
+  bridge.submitted();
+  scheduler::instance().submit(
+    scheduler::NORMAL, std::string(),
+    [run](const std::atomic < bool >&) {
+      async_run_execute(run);
+      return false;
+    },
+    [run, &bridge](bool) { bridge.post(run); });
+}
+
+void VleWrapper::submit(const FunctionCallbackInfo<Value>& args)
+{
+  Isolate* isolate = args.GetIsolate();
+  VleWrapper* obj = ObjectWrap::Unwrap<VleWrapper>(args.Holder());
+  Local < Value > callback = args[args.Length() > 0 ? args.Length() - 1 : 0];
+  scheduler::priority level = scheduler::NORMAL;
+  std::string tenant;
+
+  if (args.Length() == 0 or not callback->IsFunction()) {
+    isolate->ThrowException(Exception::TypeError(
+	String::NewFromUtf8(isolate, "submit expects a callback")));
+    return;
+  }
+
+  std::unique_ptr < async_run > job(new async_run());
+
+  if (args.Length() > 1 and args[0]->IsObject()) {
+    Local < Object > opts = args[0]->ToObject();
+    Local < Value > name = opts->Get(String::NewFromUtf8(isolate, "tenant"));
+
+    if (not parse_run_control(opts, job->control, isolate) or
+	not parse_view_filters(opts, job->filters, isolate) or
+	not parse_priority(opts->Get(String::NewFromUtf8(isolate,
+							 "priority")),
+			   level, isolate)) {
+      return;
+    }
+    if (name->IsString()) {
+      tenant = *String::Utf8Value(name);
+    }
+    job->shared = opts->Get(String::NewFromUtf8(isolate, "shared"))->
+      BooleanValue();
+  }
+
+  try {
+    job->trace_id = trace_next_id();
+
+    trace_run traced(job->trace_id);
+    trace_span span("copy");
+
+    configure_storage(*obj->_vpz);
+    job->vpz = new vpz::Vpz(*obj->_vpz);
+    apply_view_filters(*job->vpz, job->filters);
+    job->memory = obj->run_estimate();
+    job->queued = job->trace_id ? trace_now() : 0;
+  } catch(const std::exception& e) {
+    isolate->ThrowException(Exception::Error(
+	String::NewFromUtf8(isolate, e.what())));
+    return;
+  }
+  job->self.Reset(isolate, args.Holder());
+  job->callback.Reset(isolate, Local < Function >::Cast(callback));
+
+  async_run* run = job.release();
+  scheduler_bridge& bridge = scheduler_bridge::get();
+
+  bridge.submitted();
+
+  uint64_t id = scheduler::instance().submit(
+    level, tenant,
+    [run](const std::atomic < bool >& cancelled) {
+      run->control.cancel = &cancelled;
+      async_run_execute(run);
+      return run->error == "cancelled";
+    },
+    [run, &bridge](bool cancelled) {
+      if (cancelled) {
+	run->error = "cancelled";
+      }
+      bridge.post(run);
+    });
+
+  args.GetReturnValue().Set(Number::New(isolate, id));
+}
+
+void VleWrapper::run_manager(const FunctionCallbackInfo<Value>& args)
+{
+  Isolate* isolate = args.GetIsolate();
+
+  VleWrapper* obj = ObjectWrap::Unwrap<VleWrapper>(args.Holder());
+  value::Matrix* res = NULL;
+  memory_reservation reserved;
+
+  if (not reserve_run(reserved, obj->run_estimate(), isolate)) {
+    return;
+  }
+
+  try {
+    utils::ModuleManager man;
+    manager::Error error;
+    manager::Manager sim(manager::LOG_NONE,
+			 manager::SIMULATION_NONE,
+			 NULL);
+
+    trace_run traced(trace_next_id());
+
+    configure_storage(*obj->_vpz);
+    {
+      // the whole plan: the simulations run inside the manager
+      trace_span span("simulate");
+
+      res = sim.run(new vpz::Vpz(*obj->_vpz), man, 1, 0, 1, &error);
+    }
+
+    if (res == NULL) {
+      args.GetReturnValue().Set(Null(isolate));
+    } else {
+      Local < Array > retval = Array::New(isolate);
+      trace_span span("convert");
+
+      convert_list(*res, retval, isolate);
+      delete res;
+      args.GetReturnValue().Set(retval);
+    }
+  } catch(const std::exception& e) {
+    isolate->ThrowException(Exception::Error(
+	String::NewFromUtf8(isolate, e.what())));
+  }
+}
+
+void VleWrapper::run_manager_thread(const FunctionCallbackInfo<Value>& args)
+{
+  Local < Number > arg0 = args[0]->ToNumber();
+  Isolate* isolate = args.GetIsolate();
+
+  VleWrapper* obj = ObjectWrap::Unwrap<VleWrapper>(args.Holder());
+  value::Matrix* res = NULL;
+  placement where;
+  std::vector < int > cpus;
+
+  if (args.Length() > 1 and args[1]->IsObject() and
+      not parse_placement(args[1]->ToObject()->Get(
+			    String::NewFromUtf8(isolate, "placement")),
+			  where, isolate)) {
+    return;
+  }
+  if (not check_pipeline_reentry("run_manager_thread", isolate)) {
+    return;
+  }
+  where.cpus(std::max(1, static_cast < int >(arg0->Value())), cpus);
+
+  memory_reservation reserved;
+
+  if (not reserve_run(reserved, obj->run_estimate() *
+		      std::max(1, static_cast < int >(arg0->Value())),
+		      isolate)) {
+    return;
+  }
+
+  try {
+    utils::ModuleManager man;
+    manager::Error error;
+    manager::Manager sim(manager::LOG_NONE,
+			 manager::SIMULATION_NONE,
+			 NULL);
+
+    uint64_t trace_id = trace_next_id();
+    trace_run traced(trace_id);
+    int nthreads = static_cast < int >(arg0->Value());
+    std::exception_ptr failure;
+
+    configure_storage(*obj->_vpz);
+    {
+      pool_lease lease(std::max(1, nthreads));
+
+      // the threads of the manager are created by VLE and cannot be
+      // pinned one by one; they inherit the cpus of the thread calling
+      // it, a helper restricted to the placement while the main thread
+      // keeps its own cpus
+      std::thread helper([&]() {
+	  try {
+	    trace_run traced(trace_id);
+	    scoped_affinity confined(cpus);
+	    trace_span span("simulate");
+
+	    res = sim.run(new vpz::Vpz(*obj->_vpz), man, nthreads, 0, 1,
+			  &error);
+	  } catch(...) {
+	    failure = std::current_exception();
+	  }
+	});
+
+      helper.join();
+    }
+    if (failure) {
+      std::rethrow_exception(failure);
+    }
+
+    if (res == NULL) {
+      args.GetReturnValue().Set(Null(isolate));
+    } else {
+      Local < Array > retval = Array::New(isolate);
+      trace_span span("convert");
+
+      convert_list(*res, retval, isolate);
+      delete res;
+      args.GetReturnValue().Set(retval);
+    }
+  } catch(const std::exception& e) {
+    isolate->ThrowException(Exception::Error(
+	String::NewFromUtf8(isolate, e.what())));
+  }
+}
+
+void VleWrapper::run_manager_pipeline(const FunctionCallbackInfo<Value>&
+					args)
+{
+  Isolate* isolate = args.GetIsolate();
+  VleWrapper* obj = ObjectWrap::Unwrap<VleWrapper>(args.Holder());
+  Local < Object > opts = args.Length() > 0 and args[0]->IsObject() ?
+    args[0]->ToObject() : Object::New(isolate);
+  Local < Value > threads = opts->Get(String::NewFromUtf8(isolate, "threads"));
+  Local < Value > capacity = opts->Get(String::NewFromUtf8(isolate, "queue"));
+  Local < Value > each = opts->Get(String::NewFromUtf8(isolate, "each"));
+  pipeline_job job;
+  // one pool thread is left to submit and run_async
+  unsigned int pool = scheduler::instance().size() > 1 ?
+    scheduler::instance().size() - 1 : 1;
+  unsigned int nthreads = threads->IsNumber() ? threads->Uint32Value() :
+    pool;
+
+  if (not check_pipeline_reentry("run_manager_pipeline", isolate)) {
+    return;
+  }
+  nthreads = std::max(1u, std::min(nthreads, pool));
+  if (not parse_run_control(opts, job.control, isolate) or
+      not parse_view_filters(opts, job.filters, isolate)) {
+    return;
+  }
+  if (not parse_placement(opts->Get(String::NewFromUtf8(isolate,
+							  "placement")),
+			  job.where, isolate)) {
+    return;
+  }
+  job.shared = opts->Get(String::NewFromUtf8(isolate, "shared"))->
+    BooleanValue();
+  job.typed = job.shared or
+    opts->Get(String::NewFromUtf8(isolate, "typed"))->BooleanValue();
+
+  // reserved up front for the simulations in flight, the queued results
+  // and the one being converted: the producers never wait for memory
+  // while the main thread is blocked here
+  memory_reservation reserved;
+  unsigned int depth = capacity->IsNumber() and capacity->Uint32Value() > 0 ?
+    capacity->Uint32Value() : 2 * nthreads;
+
+  if (not reserve_run(reserved, obj->run_estimate() * (nthreads + depth + 1),
+		      isolate)) {
+    return;
+  }
+
+  TryCatch try_catch(isolate);
+
+  try {
+    utils::ModuleManager man;
+    vpz::Vpz base(*obj->_vpz);
+
+    configure_storage(base);
+    apply_view_filters(base, job.filters);
+    job.vpz = &base;
+    job.modules = &man;
+    job.memory = obj->run_estimate();
+    job.size = manager::ExperimentGenerator(base, 0, 1).size();
+    job.next = 0;
+    nthreads = std::max(1u, std::min(nthreads, job.size));
+
+    pipeline_queue queue(capacity->IsNumber() and capacity->Uint32Value() > 0 ?
+			 capacity->Uint32Value() : 2 * nthreads, nthreads);
+    std::vector < pipeline_worker > producers(nthreads);
+    job_group workers;
+    pipeline_guard guard(queue, workers);
+    pipeline_clock::time_point start = pipeline_clock::now();
+    Local < Array > results = Array::New(isolate, job.size);
+    double converting = 0;
+    bool aborted = false;
+    pipeline_item item;
+
+    for (unsigned int t = 0; t < nthreads; ++t) {
+      pipeline_worker* producer = &producers[t];
+
+      workers.run([&job, &queue, t, producer]() {
+	  pipeline_produce(job, queue, t, *producer);
+	});
+    }
+
+    while (queue.pop(item)) {
+      pipeline_clock::time_point begin = pipeline_clock::now();
+      HandleScope scope(isolate);
+      Local < Value > value;
+
+      if (aborted) {
+	pipeline_release(item);
+	continue;
+      }
+
+      trace_run traced(item.trace_id);
+
+      if (item.pushed and tracing()) {
+	trace_record("queued", item.trace_id, item.pushed, trace_now());
+      }
+      try {
+	trace_span span("convert");
+
+	if (item.block) {
+	  value = job.shared ? wrap_shared(*item.block, isolate) :
+	    wrap_transfer(*item.block, isolate);
+	} else if (item.result) {
+	  Local < Object > res = Object::New(isolate);
 
-  try {
-    utils::ModuleManager man;
-    manager::Error error;
-    manager::Simulation sim(manager::LOG_NONE,
-			    manager::SIMULATION_NONE,
-			    NULL);
-
-    //configure output plugins for column names
-    for(vpz::Outputs::iterator it =
-	  obj->_vpz->project().experiment().views().outputs().begin();
-	it != obj->_vpz->project().experiment().views().outputs().end(); ++it) {
-      vpz::Output& output = it->second;
-
-      if (output.package() == "vle.output" and
-	  output.plugin() == "storage") {
-	value::Map* configOutput = new value::Map();
-
-	configOutput->addString("header", "top");
-	output.setData(configOutput);
+	  convert(*item.result, res, isolate, &job.filters);
+	  value = res;
+	} else {
+	  value = Null(isolate);
+	}
+      } catch(const std::exception& e) {
+	value = Null(isolate);
+      }
+      pipeline_release(item);
+      // the external memory is only reported from the main thread
+      if (item.error.empty() and item.result_bytes) {
+	obj->record_result(item.result_bytes);
       }
-    }
 
-    res = sim.run(new vpz::Vpz(*obj->_vpz), man, &error);
+      if (each->IsFunction()) {
+	Local < Value > argv[2] = { Number::New(isolate, item.index), value };
+	trace_span span("deliver");
+
+	pipeline_delivering = true;
+	Local < Function >::Cast(each)->Call(isolate->GetCurrentContext()->
+					     Global(), 2, argv);
+	pipeline_delivering = false;
+	if (try_catch.HasCaught()) {
+	  // stop the producers, drain what is already queued
+	  aborted = true;
+	  queue.cancel();
+	}
+      } else {
+	results->Set(item.index, value);
+      }
+      converting += elapsed_ms(begin);
+    }
+    workers.wait();
+    if (aborted) {
+      try_catch.ReThrow();
+      return;
+    }
 
-    if (res == NULL) {
-      args.GetReturnValue().Set(Null(isolate));
-    } else {
-      Local < Object > retval = Object::New(isolate);
+    double wall = elapsed_ms(start);
+    double simulating = 0;
+    Local < Object > stats = Object::New(isolate);
+    Local < Object > queue_stats = Object::New(isolate);
+    Local < Object > nodes = Object::New(isolate);
+    Local < Object > retval = Object::New(isolate);
+    std::map < int, pipeline_worker > per_node;
+    std::map < int, unsigned int > node_threads;
+
+    for (unsigned int t = 0; t < producers.size(); ++t) {
+      pipeline_worker& node = per_node[producers[t].node];
+
+      node.busy += producers[t].busy;
+      node.simulations += producers[t].simulations;
+      ++node_threads[producers[t].node];
+      simulating += producers[t].busy;
+    }
+    for (std::map < int, pipeline_worker >::const_iterator it =
+	   per_node.begin(); it != per_node.end(); ++it) {
+      Local < Object > n = Object::New(isolate);
+
+      n->Set(String::NewFromUtf8(isolate, "threads"),
+	     Number::New(isolate, node_threads[it->first]));
+      n->Set(String::NewFromUtf8(isolate, "simulations"),
+	     Number::New(isolate, it->second.simulations));
+      n->Set(String::NewFromUtf8(isolate, "simulation_time"),
+	     Number::New(isolate, it->second.busy));
+      n->Set(String::NewFromUtf8(isolate, "throughput"),
+	     Number::New(isolate, wall > 0 ?
+			 it->second.simulations * 1000.0 / wall : 0.0));
+      nodes->Set(Number::New(isolate, it->first), n);
+    }
 
-      convert(*res, retval, isolate);
-      delete res;
-      args.GetReturnValue().Set(retval);
+    queue_stats->Set(String::NewFromUtf8(isolate, "capacity"),
+		     Number::New(isolate, queue.capacity()));
+    queue_stats->Set(String::NewFromUtf8(isolate, "max_depth"),
+		     Number::New(isolate, queue.max_depth()));
+    queue_stats->Set(String::NewFromUtf8(isolate, "mean_depth"),
+		     Number::New(isolate, queue.mean_depth()));
+    queue_stats->Set(String::NewFromUtf8(isolate, "producer_blocked"),
+		     Number::New(isolate, queue.blocked()));
+    queue_stats->Set(String::NewFromUtf8(isolate, "consumer_waiting"),
+		     Number::New(isolate, queue.waiting()));
+    stats->Set(String::NewFromUtf8(isolate, "experiments"),
+	       Number::New(isolate, job.size));
+    stats->Set(String::NewFromUtf8(isolate, "threads"),
+	       Number::New(isolate, nthreads));
+    stats->Set(String::NewFromUtf8(isolate, "wall_time"),
+	       Number::New(isolate, wall));
+    stats->Set(String::NewFromUtf8(isolate, "simulation_time"),
+	       Number::New(isolate, simulating));
+    stats->Set(String::NewFromUtf8(isolate, "conversion_time"),
+	       Number::New(isolate, converting));
+    stats->Set(String::NewFromUtf8(isolate, "simulation_utilization"),
+	       Number::New(isolate, wall > 0 ?
+			   simulating / (wall * nthreads) : 0.0));
+    stats->Set(String::NewFromUtf8(isolate, "conversion_utilization"),
+	       Number::New(isolate, wall > 0 ? converting / wall : 0.0));
+    stats->Set(String::NewFromUtf8(isolate, "queue"), queue_stats);
+    stats->Set(String::NewFromUtf8(isolate, "placement"),
+	       String::NewFromUtf8(isolate, policy_name(job.where.kind())));
+    stats->Set(String::NewFromUtf8(isolate, "nodes"), nodes);
+    if (not each->IsFunction()) {
+      retval->Set(String::NewFromUtf8(isolate, "results"), results);
     }
+    retval->Set(String::NewFromUtf8(isolate, "stats"), stats);
+    args.GetReturnValue().Set(retval);
   } catch(const std::exception& e) {
-    args.GetReturnValue().Set(Null(isolate));
+    isolate->ThrowException(Exception::Error(
+	String::NewFromUtf8(isolate, e.what())));
+    try_catch.ReThrow();
   }
 }
 
-void VleWrapper::run_manager(const FunctionCallbackInfo<Value>& args)
+void VleWrapper::calibrate(const FunctionCallbackInfo<Value>& args)
 {
   Isolate* isolate = args.GetIsolate();
-
   VleWrapper* obj = ObjectWrap::Unwrap<VleWrapper>(args.Holder());
-  value::Matrix* res = NULL;
+
+  if (args.Length() < 1 or not args[0]->IsObject()) {
+    isolate->ThrowException(Exception::TypeError(
+	String::NewFromUtf8(isolate, "calibrate: options object expected")));
+    return;
+  }
+  if (not check_pipeline_reentry("calibrate", isolate)) {
+    return;
+  }
+
+  Local < Object > opts = args[0]->ToObject();
+  Local < Value > progress = opts->Get(String::NewFromUtf8(isolate,
+							   "progress"));
+  calibration_problem pb;
+  optimizer_options options;
+  std::vector < double > x0;
+  std::string algo;
+
+  if (not parse_calibration(opts, *obj->_vpz, pb, options, x0, algo,
+			    isolate)) {
+    return;
+  }
+
+  // the base copy and one simulation per thread
+  memory_reservation reserved;
+
+  if (not reserve_run(reserved, obj->run_estimate() * (pb.threads + 1),
+		      isolate)) {
+    return;
+  }
+
+  TryCatch try_catch(isolate);
 
   try {
     utils::ModuleManager man;
-    manager::Error error;
-    manager::Manager sim(manager::LOG_NONE,
-			 manager::SIMULATION_NONE,
-			 NULL);
+    vpz::Vpz base(*obj->_vpz);
 
-    //configure output plugins for column names
-    for(vpz::Outputs::iterator it =
-	  obj->_vpz->project().experiment().views().outputs().begin();
-	it != obj->_vpz->project().experiment().views().outputs().end(); ++it) {
-      vpz::Output& output = it->second;
+    configure_storage(base);
+    pb.vpz = &base;
+    pb.modules = &man;
 
-      if (output.package() == "vle.output" and
-	  output.plugin() == "storage") {
-	value::Map* configOutput = new value::Map();
+    batch_objective f = [&pb](const point_list& points,
+			      std::vector < double >& values)
+      { calibration_evaluate(pb, points, values); };
 
-	configOutput->addString("header", "top");
-	output.setData(configOutput);
+    // progress events are delivered synchronously between two
+    // iterations, the simulations themselves never touch V8
+    optimizer_progress report = [&](const optimizer_result& current) {
+      if (not progress->IsFunction()) {
+	return;
       }
-    }
 
-    res = sim.run(new vpz::Vpz(*obj->_vpz), man, 1, 0, 1, &error);
+      HandleScope scope(isolate);
+      Local < Value > argv[1] = { calibration_event(pb, current, isolate) };
 
-    if (res == NULL) {
-      args.GetReturnValue().Set(Null(isolate));
-    } else {
-      Local < Array > retval = Array::New(isolate);
+      Local < Function >::Cast(progress)->Call(isolate->GetCurrentContext()->
+					       Global(), 1, argv);
+      if (try_catch.HasCaught()) {
+	throw calibration_aborted();
+      }
+    };
 
-      convert_list(*res, retval, isolate);
-      delete res;
-      args.GetReturnValue().Set(retval);
-    }
+    optimizer_result best = algo == "cmaes" ?
+      cmaes(x0, f, options, report) : nelder_mead(x0, f, options, report);
+
+    args.GetReturnValue().Set(calibration_result(pb, best, isolate));
+  } catch(const calibration_aborted& e) {
+    try_catch.ReThrow();
   } catch(const std::exception& e) {
-    args.GetReturnValue().Set(Null(isolate));
+    isolate->ThrowException(Exception::Error(
+	String::NewFromUtf8(isolate, e.what())));
   }
 }
 
-void VleWrapper::run_manager_thread(const FunctionCallbackInfo<Value>& args)
+void VleWrapper::calibrate_async(const FunctionCallbackInfo<Value>& args)
 {
-  Local < Number > arg0 = args[0]->ToNumber();
   Isolate* isolate = args.GetIsolate();
-
   VleWrapper* obj = ObjectWrap::Unwrap<VleWrapper>(args.Holder());
-  value::Matrix* res = NULL;
-
-  try {
-    utils::ModuleManager man;
-    manager::Error error;
-    manager::Manager sim(manager::LOG_NONE,
-			 manager::SIMULATION_NONE,
-			 NULL);
-
-    //configure output plugins for column names
-    for(vpz::Outputs::iterator it =
-	  obj->_vpz->project().experiment().views().outputs().begin();
-	it != obj->_vpz->project().experiment().views().outputs().end(); ++it) {
-      vpz::Output& output = it->second;
-
-      if (output.package() == "vle.output" and
-	  output.plugin() == "storage") {
-	value::Map* configOutput = new value::Map();
 
-	configOutput->addString("header", "top");
-	output.setData(configOutput);
-      }
-    }
+  if (args.Length() < 2 or not args[0]->IsObject() or
+      not args[1]->IsFunction()) {
+    isolate->ThrowException(Exception::TypeError(
+	String::NewFromUtf8(isolate, "calibrate_async: options object and "
+			    "callback expected")));
+    return;
+  }
 
-    res = sim.run(new vpz::Vpz(*obj->_vpz), man,
-		  static_cast < int >(arg0->Value()), 0, 1, &error);
+  Local < Object > opts = args[0]->ToObject();
+  Local < Value > progress = opts->Get(String::NewFromUtf8(isolate,
+							   "progress"));
+  std::unique_ptr < calibration_job > job(new calibration_job());
 
-    if (res == NULL) {
-      args.GetReturnValue().Set(Null(isolate));
-    } else {
-      Local < Array > retval = Array::New(isolate);
+  if (not parse_calibration(opts, *obj->_vpz, job->pb, job->options,
+			    job->x0, job->algo, isolate)) {
+    return;
+  }
+  try {
+    job->vpz = new vpz::Vpz(*obj->_vpz);
+    configure_storage(*job->vpz);
+  } catch(const std::exception& e) {
+    isolate->ThrowException(Exception::Error(
+	String::NewFromUtf8(isolate, e.what())));
+    return;
+  }
+  job->pb.vpz = job->vpz;
+  job->pb.modules = &job->modules;
+  // the base copy and one simulation per thread
+  job->memory = obj->run_estimate() * (job->pb.threads + 1);
+  job->self.Reset(isolate, args.Holder());
+  if (progress->IsFunction()) {
+    job->progress.Reset(isolate, Local < Function >::Cast(progress));
+    job->reporting = true;
+  }
+  job->callback.Reset(isolate, Local < Function >::Cast(args[1]));
 
-      convert_list(*res, retval, isolate);
-      delete res;
-      args.GetReturnValue().Set(retval);
-    }
+  uv_async_init(uv_default_loop(), &job->async, calibration_deliver);
+  job->async.data = job.get();
+  try {
+    job->thread = std::thread(calibration_run, job.get());
   } catch(const std::exception& e) {
-    args.GetReturnValue().Set(Null(isolate));
+    uv_close(reinterpret_cast < uv_handle_t* >(&job.release()->async),
+	     calibration_close);
+    isolate->ThrowException(Exception::Error(
+	String::NewFromUtf8(isolate, e.what())));
+    return;
   }
+  job.release();
 }
 
 void VleWrapper::condition_list(const FunctionCallbackInfo<Value>& args)
@@ -729,7 +4219,7 @@ void VleWrapper::condition_list(const FunctionCallbackInfo<Value>& args)
     obj->_vpz->project().experiment().conditions().conditionnames(lst);
     i = 0;
     for (it = lst.begin(); it != lst.end(); ++it, ++i)
-      result->Set(i, String::NewFromUtf8(isolate, it->c_str()));
+      result->Set(i, key(*it, isolate));
   }
   args.GetReturnValue().Set(result);
 }
@@ -773,6 +4263,7 @@ void VleWrapper::condition_create(const FunctionCallbackInfo<Value>& args)
 				    conditions());
 
     listConditions.add(newCond);
+    obj->_created = ++obj->_epoch;
   }
 }
 
@@ -794,7 +4285,7 @@ void VleWrapper::condition_port_list(const FunctionCallbackInfo<Value>& args)
 
       cnd.portnames(lst);
       for (it = lst.begin(); it != lst.end(); ++it, ++i)
-	result->Set(i, String::NewFromUtf8(isolate, it->c_str()));
+	result->Set(i, key(*it, isolate));
     }
     args.GetReturnValue().Set(result);
   }
@@ -812,6 +4303,7 @@ void VleWrapper::condition_port_clear(const FunctionCallbackInfo<Value>& args)
 			conditions().get(conditionname));
 
     cnd.clearValueOfPort(portname);
+    obj->touch(conditionname, portname);
   }
 }
 
@@ -829,6 +4321,7 @@ void VleWrapper::condition_add_real(const FunctionCallbackInfo<Value>& args)
 			conditions().get(conditionname));
 
     cnd.addValueToPort(portname, value::Double::create(value));
+    obj->touch(conditionname, portname);
   }
 }
 
@@ -846,6 +4339,7 @@ void VleWrapper::condition_add_integer(const FunctionCallbackInfo<Value>& args)
 			conditions().get(conditionname));
 
     cnd.addValueToPort(portname, value::Integer::create(value));
+    obj->touch(conditionname, portname);
   }
 }
 
@@ -863,6 +4357,7 @@ void VleWrapper::condition_add_string(const FunctionCallbackInfo<Value>& args)
 			conditions().get(conditionname));
 
     cnd.addValueToPort(portname, value::String::create(value));
+    obj->touch(conditionname, portname);
   }
 }
 
@@ -880,6 +4375,7 @@ void VleWrapper::condition_add_boolean(const FunctionCallbackInfo<Value>& args)
 			conditions().get(conditionname));
 
     cnd.addValueToPort(portname, value::Boolean::create(value));
+    obj->touch(conditionname, portname);
   }
 }
 
@@ -897,6 +4393,7 @@ void VleWrapper::condition_add_value(const FunctionCallbackInfo<Value>& args)
 			conditions().get(conditionname));
 
     cnd.addValueToPort(portname, *value->get_value());
+    obj->touch(conditionname, portname);
   }
 }
 
@@ -919,6 +4416,7 @@ void VleWrapper::condition_set_port_value(const FunctionCallbackInfo<Value>&
     value::VectorValue& vector(cnd.getSetValues(portname).value());
 
     vector.at(index) = value->get_value()->clone();
+    obj->touch(conditionname, portname);
   }
 }
 
@@ -1042,6 +4540,7 @@ void VleWrapper::condition_delete_value(const FunctionCallbackInfo<Value>& args)
     }
     if (it != vector.end()) {
       vector.erase(it);
+      obj->touch(conditionname, portname);
     }
   }
 }
@@ -1069,6 +4568,7 @@ void VleWrapper::output_set_plugin(const FunctionCallbackInfo<Value>& args)
     } else {
       out.setDistantStream(location, plugin, package);
     }
+    obj->_outputs = ++obj->_epoch;
   }
 }
 
@@ -1083,16 +4583,529 @@ void VleWrapper::outputs_list(const FunctionCallbackInfo<Value>& args)
 
   for (vpz::OutputList::const_iterator it = lst.begin(); it != lst.end();
        ++it, ++i) {
-    result->Set(i, String::NewFromUtf8(isolate, it->first.c_str()));
+    result->Set(i, key(it->first, isolate));
+  }
+  args.GetReturnValue().Set(result);
+}
+
+/*  - - - - - - - - - - - - - --ooOoo-- - - - - - - - - - - -  */
+
+void VleWrapper::save_snapshot(const FunctionCallbackInfo<Value>& args)
+{
+  Isolate* isolate = args.GetIsolate();
+  VleWrapper* obj = ObjectWrap::Unwrap<VleWrapper>(args.Holder());
+
+  if (not obj->_vpz) {
+    isolate->ThrowException(Exception::Error(
+	String::NewFromUtf8(isolate, "no experiment loaded")));
+    return;
+  }
+
+  std::string path = *String::Utf8Value(args[0]->ToString());
+
+  try {
+    ::save_snapshot(path, *obj->_vpz);
+  } catch(const std::exception& e) {
+    isolate->ThrowException(Exception::Error(
+	String::NewFromUtf8(isolate, e.what())));
+  }
+}
+
+void VleWrapper::from_snapshot(const FunctionCallbackInfo<Value>& args)
+{
+  Isolate* isolate = args.GetIsolate();
+  std::string path = *String::Utf8Value(args[0]->ToString());
+  vpz::Vpz* vpz;
+
+  try {
+    ensure_init();
+    vpz = load_snapshot(path);
+  } catch(const std::exception& e) {
+    isolate->ThrowException(Exception::Error(
+	String::NewFromUtf8(isolate, e.what())));
+    return;
+  }
+  args.GetReturnValue().Set(NewInstance(vpz, isolate));
+}
+
+/*  - - - - - - - - - - - - - --ooOoo-- - - - - - - - - - - -  */
+
+void VleWrapper::snapshot(const FunctionCallbackInfo<Value>& args)
+{
+  Isolate* isolate = args.GetIsolate();
+  VleWrapper* obj = ObjectWrap::Unwrap<VleWrapper>(args.Holder());
+  experiment_state* state = new experiment_state();
+
+  try {
+    capture_state(*obj->_vpz, *state);
+  } catch(const std::exception& e) {
+    delete state;
+    isolate->ThrowException(Exception::Error(
+	String::NewFromUtf8(isolate, e.what())));
+    return;
+  }
+  args.GetReturnValue().Set(SnapshotWrapper::NewInstance(state, obj->_id,
+							 obj->_epoch,
+							 isolate));
+}
+
+void VleWrapper::restore(const FunctionCallbackInfo<Value>& args)
+{
+  Isolate* isolate = args.GetIsolate();
+  VleWrapper* obj = ObjectWrap::Unwrap<VleWrapper>(args.Holder());
+
+  if (args.Length() < 1 or not SnapshotWrapper::HasInstance(args[0], isolate)) {
+    isolate->ThrowException(Exception::TypeError(
+	String::NewFromUtf8(isolate, "restore expects a snapshot")));
+    return;
+  }
+
+  SnapshotWrapper* snap = ObjectWrap::Unwrap<SnapshotWrapper>(
+    args[0]->ToObject());
+  const experiment_state& state = *snap->state();
+  vpz::Experiment& exp = obj->_vpz->project().experiment();
+
+  try {
+    exp.setBegin(state.begin);
+    exp.setDuration(state.duration);
+    exp.setSeed(state.seed);
+
+    if (snap->owner() != obj->_id or snap->epoch() < obj->_reset or
+	snap->epoch() < obj->_created) {
+      // foreign snapshot or structural change: put everything back and
+      // invalidate the older snapshots of this wrapper
+      restore_conditions(*obj->_vpz, state);
+      restore_outputs(*obj->_vpz, state);
+      obj->_touched.clear();
+      obj->_created = 0;
+      obj->_outputs = 0;
+      obj->_reset = ++obj->_epoch;
+    } else {
+      for (port_epochs::iterator it = obj->_touched.begin();
+	   it != obj->_touched.end(); ++it) {
+	if (it->second > snap->epoch()) {
+	  restore_port(*obj->_vpz, state, it->first.first, it->first.second);
+	  // the port changed again for the snapshots taken in between
+	  it->second = ++obj->_epoch;
+	}
+      }
+      if (obj->_outputs > snap->epoch()) {
+	restore_outputs(*obj->_vpz, state);
+	obj->_outputs = ++obj->_epoch;
+      }
+    }
+  } catch(const std::exception& e) {
+    isolate->ThrowException(Exception::Error(
+	String::NewFromUtf8(isolate, e.what())));
+  }
+}
+
+void VleWrapper::clone(const FunctionCallbackInfo<Value>& args)
+{
+  Isolate* isolate = args.GetIsolate();
+  VleWrapper* obj = ObjectWrap::Unwrap<VleWrapper>(args.Holder());
+
+  if (not obj->_vpz) {
+    isolate->ThrowException(Exception::Error(
+	String::NewFromUtf8(isolate, "no experiment loaded")));
+    return;
+  }
+  args.GetReturnValue().Set(NewInstance(new vpz::Vpz(*obj->_vpz), isolate));
+}
+
+/*  - - - - - - - - - - - - - --ooOoo-- - - - - - - - - - - -  */
+
+Persistent<Function> SnapshotWrapper::constructor;
+Persistent<FunctionTemplate> SnapshotWrapper::tpl;
+
+void SnapshotWrapper::Init(Handle<Object> exports)
+{
+  Isolate* isolate = exports->GetIsolate();
+  Local<FunctionTemplate> t = FunctionTemplate::New(isolate, New);
+
+  t->SetClassName(String::NewFromUtf8(isolate, "Snapshot"));
+  t->InstanceTemplate()->SetInternalFieldCount(1);
+
+  // only created by Vle.snapshot, not exported
+  tpl.Reset(isolate, t);
+  constructor.Reset(isolate, t->GetFunction());
+}
+
+Local < Object > SnapshotWrapper::NewInstance(experiment_state* state,
+					      uint64_t owner, uint64_t epoch,
+					      Isolate* isolate)
+{
+  EscapableHandleScope scope(isolate);
+  Local < Function > cons = Local < Function >::New(isolate, constructor);
+  Local < Object > instance = cons->NewInstance();
+  SnapshotWrapper* obj = ObjectWrap::Unwrap<SnapshotWrapper>(instance);
+
+  obj->_state = state;
+  obj->_owner = owner;
+  obj->_epoch = epoch;
+  obj->_memory.update(state_size(*state));
+  return scope.Escape(instance);
+}
+
+bool SnapshotWrapper::HasInstance(Local < Value > value, Isolate* isolate)
+{
+  Local < FunctionTemplate > t = Local < FunctionTemplate >::New(isolate, tpl);
+
+  return value->IsObject() and t->HasInstance(value) and
+    ObjectWrap::Unwrap<SnapshotWrapper>(value->ToObject())->_state;
+}
+
+void SnapshotWrapper::New(const FunctionCallbackInfo<Value>& jsargs)
+{
+  if (jsargs.IsConstructCall()) {
+    SnapshotWrapper* obj = new SnapshotWrapper();
+
+    obj->Wrap(jsargs.This());
+    jsargs.GetReturnValue().Set(jsargs.This());
+  }
+}
+
+/*  - - - - - - - - - - - - - --ooOoo-- - - - - - - - - - - -  */
+
+// One side of vle.compare: a ColumnFile, a CompressedResult, the path of
+// a column file, or a result object whose leaves are typed arrays (run
+// with typed results, run_async) or arrays (run). Columns are named
+// view.coupled.atomic.port; typed arrays and mapped files are read in
+// place, compressed columns are decoded once.
+class compare_operand
+{
+public:
+  compare_operand() : _file(0), _compressed(0)
+  { }
+
+  bool open(Local < Value > v, Isolate* isolate)
+  {
+    if (v->IsString()) {
+      try {
+	_owned.reset(new column_file(*String::Utf8Value(v)));
+      } catch(const std::exception& e) {
+	isolate->ThrowException(Exception::Error(
+	    String::NewFromUtf8(isolate, e.what())));
+	return false;
+      }
+      _file = _owned.get();
+    } else if (ColumnFileWrapper::HasInstance(v, isolate)) {
+      _file = node::ObjectWrap::Unwrap<ColumnFileWrapper>(v->ToObject())->
+	file();
+    } else if (CompressedResultWrapper::HasInstance(v, isolate)) {
+      _compressed = node::ObjectWrap::Unwrap<CompressedResultWrapper>(
+	v->ToObject())->columns();
+    } else if (v->IsObject()) {
+      walk(v->ToObject(), std::string());
+      return true;
+    } else {
+      isolate->ThrowException(Exception::TypeError(
+	  String::NewFromUtf8(isolate, "compare: result or path expected")));
+      return false;
+    }
+
+    if (_file) {
+      for (unsigned int i = 0; i < _file->columns().size(); ++i) {
+	_names.push_back(_file->columns()[i].name);
+      }
+    } else if (_compressed) {
+      for (unsigned int i = 0; i < _compressed->size(); ++i) {
+	_names.push_back((*_compressed)[i].name);
+      }
+    }
+    return true;
+  }
+
+  const std::vector < std::string >& names() const
+  { return _names; }
+
+  // time column of the view of a column: view names may hold dots, the
+  // longest view of a time column prefixing the name is taken; empty
+  // when there is none
+  std::string time_column(const std::string& name) const
+  {
+    std::string found;
+
+    for (unsigned int i = 0; i < _names.size(); ++i) {
+      const std::string& t = _names[i];
+
+      if (t.size() > 5 and t.compare(t.size() - 5, 5, ".time") == 0 and
+	  t.size() > found.size() and
+	  name.compare(0, t.size() - 4, t, 0, t.size() - 4) == 0) {
+	found = t;
+      }
+    }
+    return found;
+  }
+
+  // 0 when the column does not exist
+  const double* column(const std::string& name, size_t& rows)
+  {
+    std::map < std::string, std::pair < const double*, size_t > >::iterator
+      it = _columns.find(name);
+
+    if (it != _columns.end()) {
+      rows = it->second.second;
+      return it->second.first;
+    }
+    if (_file) {
+      int index = _file->find(name);
+
+      if (index >= 0) {
+	const column_file::entry& e = _file->columns()[index];
+
+	rows = e.rows;
+	return _file->data(e);
+      }
+    } else if (_compressed) {
+      for (unsigned int i = 0; i < _compressed->size(); ++i) {
+	if ((*_compressed)[i].name == name) {
+	  std::vector < double >& data = _decoded[name];
+
+	  data.resize((*_compressed)[i].rows);
+	  decompress_column((*_compressed)[i], data.data());
+	  _columns[name] = std::make_pair(data.data(), data.size());
+	  rows = data.size();
+	  return data.data();
+	}
+      }
+    }
+    return 0;
+  }
+
+private:
+  void walk(Local < Object > obj, const std::string& prefix)
+  {
+    Local < Array > keys = obj->GetOwnPropertyNames();
+
+    for (unsigned int i = 0; i < keys->Length(); ++i) {
+      Local < Value > v = obj->Get(keys->Get(i));
+      std::string name = prefix + *String::Utf8Value(keys->Get(i));
+
+      if (v->IsFloat64Array()) {
+	Local < Float64Array > array = Local < Float64Array >::Cast(v);
+	const char* base = static_cast < const char* >(
+	  array->Buffer()->GetContents().Data());
+
+	_columns[name] = std::make_pair(
+	  reinterpret_cast < const double* >(base + array->ByteOffset()),
+	  array->Length());
+	_names.push_back(name);
+      } else if (v->IsArray() or v->IsTypedArray()) {
+	std::vector < double >& data = _decoded[name];
+
+	to_doubles(v, data);
+	_columns[name] = std::make_pair(data.data(), data.size());
+	_names.push_back(name);
+      } else if (v->IsObject() and not v->IsFunction()) {
+	walk(v->ToObject(), name + ".");
+      }
+    }
+  }
+
+  std::unique_ptr < column_file > _owned;
+  const column_file* _file;
+  const CompressedResultWrapper::column_list* _compressed;
+  std::vector < std::string > _names;
+  std::map < std::string, std::pair < const double*, size_t > > _columns;
+  std::map < std::string, std::vector < double > > _decoded;
+};
+
+// vle.compare(a, b, {atol, rtol, columns}): b is the reference
+void compare(const FunctionCallbackInfo<Value>& args)
+{
+  Isolate* isolate = args.GetIsolate();
+  compare_operand a;
+  compare_operand b;
+  double atol = 0;
+  double rtol = 0;
+  std::vector < std::string > names;
+
+  if (args.Length() < 2 or not a.open(args[0], isolate) or
+      not b.open(args[1], isolate)) {
+    if (args.Length() < 2) {
+      isolate->ThrowException(Exception::TypeError(
+	  String::NewFromUtf8(isolate, "compare: two results expected")));
+    }
+    return;
+  }
+  if (args.Length() > 2 and args[2]->IsObject()) {
+    Local < Object > opts = args[2]->ToObject();
+    Local < Value > columns = opts->Get(String::NewFromUtf8(isolate,
+							    "columns"));
+
+    if (opts->Has(String::NewFromUtf8(isolate, "atol"))) {
+      atol = opts->Get(String::NewFromUtf8(isolate, "atol"))->NumberValue();
+    }
+    if (opts->Has(String::NewFromUtf8(isolate, "rtol"))) {
+      rtol = opts->Get(String::NewFromUtf8(isolate, "rtol"))->NumberValue();
+    }
+    if (columns->IsArray()) {
+      for (unsigned int i = 0; i < Local < Array >::Cast(columns)->Length();
+	   ++i) {
+	names.push_back(*String::Utf8Value(
+			  Local < Array >::Cast(columns)->Get(i)));
+      }
+    }
+  }
+  if (names.empty()) {
+    std::set < std::string > all(a.names().begin(), a.names().end());
+
+    all.insert(b.names().begin(), b.names().end());
+    names.assign(all.begin(), all.end());
+  }
+
+  Local < Object > result = Object::New(isolate);
+  Local < Object > columns = Object::New(isolate);
+  Local < Array > missing = Array::New(isolate);
+  bool passed = true;
+
+  for (unsigned int i = 0; i < names.size(); ++i) {
+    size_t na = 0;
+    size_t nb = 0;
+    const double* da;
+    const double* db;
+
+    try {
+      da = a.column(names[i], na);
+      db = b.column(names[i], nb);
+    } catch(const std::exception& e) {
+      isolate->ThrowException(Exception::Error(
+	  String::NewFromUtf8(isolate, e.what())));
+      return;
+    }
+
+    if (not da or not db) {
+      missing->Set(missing->Length(), key(names[i], isolate));
+      passed = false;
+      continue;
+    }
+
+    column_diff diff;
+    Local < Object > c = Object::New(isolate);
+
+    compare_columns(da, na, db, nb, atol, rtol, diff);
+    c->Set(String::NewFromUtf8(isolate, "passed"),
+	   Boolean::New(isolate, diff.passed));
+    c->Set(String::NewFromUtf8(isolate, "rows"),
+	   Number::New(isolate, diff.rows));
+    c->Set(String::NewFromUtf8(isolate, "failures"),
+	   Number::New(isolate, diff.failures));
+    c->Set(String::NewFromUtf8(isolate, "max_error"),
+	   Number::New(isolate, diff.max_error));
+    c->Set(String::NewFromUtf8(isolate, "rms_error"),
+	   Number::New(isolate, diff.rms_error));
+    c->Set(String::NewFromUtf8(isolate, "first_divergence"),
+	   Number::New(isolate, diff.first_divergence));
+    if (diff.first_divergence >= 0) {
+      // time of the divergence, from the time column of the same view
+      size_t nt = 0;
+      const double* time = 0;
+      std::string time_name = a.time_column(names[i]);
+
+      try {
+	time = time_name.empty() ? 0 : a.column(time_name, nt);
+      } catch(const std::exception& e) {
+      }
+
+      if (time and static_cast < size_t >(diff.first_divergence) < nt) {
+	c->Set(String::NewFromUtf8(isolate, "first_divergence_time"),
+	       Number::New(isolate, time[diff.first_divergence]));
+      }
+    }
+    columns->Set(key(names[i], isolate), c);
+    passed = passed and diff.passed;
   }
+  result->Set(String::NewFromUtf8(isolate, "passed"),
+	      Boolean::New(isolate, passed));
+  result->Set(String::NewFromUtf8(isolate, "columns"), columns);
+  result->Set(String::NewFromUtf8(isolate, "missing"), missing);
   args.GetReturnValue().Set(result);
 }
 
 /*  - - - - - - - - - - - - - --ooOoo-- - - - - - - - - - - -  */
 
+#ifdef NODE_VLE_BENCH
+
+/*  - - - - - - - - - - - - - --ooOoo-- - - - - - - - - - - -  */
+
+// bench_convert(columns, rows, rounds): ms per convert of a result with
+// one view of distinct columns, the marshal cache emptied before each
+// round (cold) or kept (warm). Only in the bench target of binding.gyp,
+// see bench_marshal.js
+void bench_convert(const FunctionCallbackInfo<Value>& args)
+{
+  Isolate* isolate = args.GetIsolate();
+  unsigned int columns = std::max(2u, args[0]->Uint32Value());
+  unsigned int rows = args[1]->Uint32Value();
+  unsigned int rounds = std::max(1u, args[2]->Uint32Value());
+  value::Map out;
+  value::Matrix* matrix = new value::Matrix(columns, rows + 1, 0, 0);
+  double cold = 0;
+  double warm = 0;
+
+  out.add("view", matrix);
+  matrix->addValue(0, 0, new value::String("time"));
+  for (unsigned int c = 1; c < columns; ++c) {
+    std::ostringstream name;
+
+    name << "Top:Model_" << c / 8 << ".port_" << c;
+    matrix->addValue(c, 0, new value::String(name.str()));
+  }
+  for (unsigned int r = 1; r <= rows; ++r) {
+    for (unsigned int c = 0; c < columns; ++c) {
+      matrix->addValue(c, r, new value::Double(c == 0 ? r : r * c));
+    }
+  }
+
+  for (unsigned int i = 0; i < 2 * rounds; ++i) {
+    HandleScope scope(isolate);
+    Local < Object > res = Object::New(isolate);
+
+    // the warm rounds keep what the last cold one cached
+    if (i < rounds) {
+      marshal_cache::get(isolate).clear();
+    }
+
+    std::chrono::steady_clock::time_point start =
+      std::chrono::steady_clock::now();
+
+    convert(out, res, isolate);
+    (i < rounds ? cold : warm) += std::chrono::duration <
+      double, std::milli >(std::chrono::steady_clock::now() - start).count();
+  }
+
+  Local < Object > retval = Object::New(isolate);
+
+  retval->Set(String::NewFromUtf8(isolate, "cold"),
+	      Number::New(isolate, cold / rounds));
+  retval->Set(String::NewFromUtf8(isolate, "warm"),
+	      Number::New(isolate, warm / rounds));
+  args.GetReturnValue().Set(retval);
+}
+
+#endif
+
 void InitAll(Local<Object> exports) {
   ValueWrapper::Init(exports);
   VleWrapper::Init(exports);
+  ColumnFileWrapper::Init(exports);
+  SnapshotWrapper::Init(exports);
+  CompressedResultWrapper::Init(exports);
+  NODE_SET_METHOD(exports, "compare", compare);
+  NODE_SET_METHOD(exports, "cancel", scheduler_cancel);
+  NODE_SET_METHOD(exports, "set_quota", scheduler_set_quota);
+  NODE_SET_METHOD(exports, "scheduler_stats", scheduler_stats);
+  NODE_SET_METHOD(exports, "set_placement", scheduler_set_placement);
+  NODE_SET_METHOD(exports, "topology", topology);
+  NODE_SET_METHOD(exports, "trace_start", tracing_start);
+  NODE_SET_METHOD(exports, "trace_stop", tracing_stop);
+  NODE_SET_METHOD(exports, "trace_dump", tracing_dump);
+  NODE_SET_METHOD(exports, "memory", memory);
+  NODE_SET_METHOD(exports, "set_memory_budget", memory_set_budget);
+#ifdef NODE_VLE_BENCH
+  NODE_SET_METHOD(exports, "bench_convert", bench_convert);
+#endif
 }
 
 NODE_MODULE(vle_node, InitAll)